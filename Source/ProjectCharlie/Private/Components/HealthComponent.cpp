@@ -1,11 +1,17 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "../../Public/Components/HealthComponent.h"
+#include "Systems/PCDamageTelemetry.h"
+#include "TimerManager.h"
+#include "Engine/World.h"
 
 // Sets default values for this component's properties
 UHealthComponent::UHealthComponent()
 {
 	DefaultHealth = 100;
+
+	bBatchDamage = false;
+	BatchedDamage = 0.0f;
 }
 
 
@@ -34,8 +40,43 @@ void UHealthComponent::HandleTakeAnyDamage(AActor * DamagedActor, float Damage,
 
 	Health = FMath::Clamp(Health - Damage, 0.0f, DefaultHealth);
 
-	UE_LOG(LogTemp, Log, TEXT("Health Changed: %s"), *FString::SanitizeFloat(Health));
+	APCDamageTelemetry::RecordDamage(DamagedActor, Damage, Health, DamageType, InstigatedBy, DamageCauser);
 
 	OnHealthChanged.Broadcast(this, Health, Damage, DamageType, InstigatedBy, DamageCauser);
+
+	if (!bBatchDamage)
+	{
+		return;
+	}
+
+	BatchedDamage += Damage;
+	BatchedInstigators.AddUnique(InstigatedBy);
+
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	if (!TimerManager.IsTimerActive(TimerHandle_FlushBatchedDamage))
+	{
+		TimerHandle_FlushBatchedDamage = TimerManager.SetTimerForNextTick(this, &UHealthComponent::FlushBatchedDamage);
+	}
+}
+
+/*
+	FlushBatchedDamage
+	======================================================================
+	One broadcast for every hit taken since the last flush, so a shotgun
+	blast or a burst of automatic fire costs listeners that bind
+	OnHealthChangedBatch instead of OnHealthChanged one call a frame.
+	======================================================================
+*/
+void UHealthComponent::FlushBatchedDamage()
+{
+	if (BatchedDamage <= 0.0f)
+	{
+		return;
+	}
+
+	OnHealthChangedBatch.Broadcast(this, Health, BatchedDamage, BatchedInstigators);
+
+	BatchedDamage = 0.0f;
+	BatchedInstigators.Reset();
 }
 
@@ -0,0 +1,274 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/InventoryComponent.h"
+#include "ProjectCharlie.h"
+#include "Net/UnrealNetwork.h"
+
+void FInventoryEntry::PostReplicatedAdd(const FInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnEntryAdded(*this);
+	}
+}
+
+void FInventoryEntry::PostReplicatedChange(const FInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnEntryChanged(*this);
+	}
+}
+
+void FInventoryEntry::PreReplicatedRemove(const FInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnEntryRemoved();
+	}
+}
+
+UInventoryComponent::UInventoryComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	SetIsReplicated(true);
+
+	Items.Owner = this;
+	bItemIdsDirty = false;
+}
+
+void UInventoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Items.Owner = this;
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		for (const FInventoryStartingItem& StartingItem : StartingItems)
+		{
+			AddItem(StartingItem.ItemClass, StartingItem.Count);
+		}
+	}
+}
+
+void UInventoryComponent::RebuildItemIds() const
+{
+	ItemIds.Reset();
+	MagazineSlots.Reset();
+
+	for (int32 i = 0; i < Items.Entries.Num(); i++)
+	{
+		if (Items.Entries[i].ItemClass)
+		{
+			ItemIds.Add(Items.Entries[i].ItemClass, (uint16)i);
+		}
+	}
+
+	bItemIdsDirty = false;
+}
+
+uint16 UInventoryComponent::FindItemId(UClass* ItemClass) const
+{
+	if (bItemIdsDirty)
+	{
+		RebuildItemIds();
+	}
+
+	const uint16* ItemId = ItemIds.Find(ItemClass);
+	return ItemId ? *ItemId : NoItem;
+}
+
+int32 UInventoryComponent::GetCount(TSubclassOf<AActor> ItemClass) const
+{
+	return GetCountById(FindItemId(ItemClass));
+}
+
+uint16 UInventoryComponent::AddSlot(UClass* ItemClass)
+{
+	if (Items.Entries.Num() >= NoItem)
+	{
+		return NoItem;
+	}
+
+	FInventoryEntry& Entry = Items.Entries.AddDefaulted_GetRef();
+	Entry.ItemClass = ItemClass;
+	Items.MarkItemDirty(Entry);
+
+	OnEntryAdded(Entry);
+
+	return (uint16)(Items.Entries.Num() - 1);
+}
+
+int32 UInventoryComponent::AddItem(TSubclassOf<AActor> ItemClass, int32 Count)
+{
+	if (!ItemClass || Count <= 0 || GetOwnerRole() != ROLE_Authority)
+	{
+		return GetCount(ItemClass);
+	}
+
+	uint16 ItemId = FindItemId(ItemClass);
+	if (ItemId == NoItem)
+	{
+		ItemId = AddSlot(ItemClass);
+		if (ItemId == NoItem)
+		{
+			return 0;
+		}
+	}
+
+	FInventoryEntry& Entry = Items.Entries[ItemId];
+	Entry.Count += Count;
+	Items.MarkItemDirty(Entry);
+
+	OnInventoryChanged.Broadcast(this, Entry.ItemClass, Entry.Count);
+
+	return Entry.Count;
+}
+
+int32 UInventoryComponent::RemoveItem(TSubclassOf<AActor> ItemClass, int32 Count)
+{
+	const uint16 ItemId = FindItemId(ItemClass);
+	if (ItemId == NoItem || Count <= 0 || GetOwnerRole() != ROLE_Authority)
+	{
+		return 0;
+	}
+
+	// The slot stays when it runs out so item ids never move
+	FInventoryEntry& Entry = Items.Entries[ItemId];
+	const int32 Removed = FMath::Min(Count, Entry.Count);
+	if (Removed > 0)
+	{
+		Entry.Count -= Removed;
+		Items.MarkItemDirty(Entry);
+
+		OnInventoryChanged.Broadcast(this, Entry.ItemClass, Entry.Count);
+	}
+
+	return Removed;
+}
+
+/*
+	FindBestMagazine
+	======================================================================
+	A magazine fits a weapon if it is the weapon's magazine class or a
+	child of it. The fitting slots are worked out the first time a weapon
+	asks and kept up to date as slots are added, so a lookup only looks
+	at the handful of magazine types that fit.
+	======================================================================
+*/
+TSubclassOf<APCMagazineBase> UInventoryComponent::FindBestMagazine(TSubclassOf<APCMagazineBase> WeaponMagazineClass) const
+{
+	if (!WeaponMagazineClass)
+	{
+		return nullptr;
+	}
+
+	if (bItemIdsDirty)
+	{
+		RebuildItemIds();
+	}
+
+	const TArray<uint16>* Slots = MagazineSlots.Find(WeaponMagazineClass);
+	if (!Slots)
+	{
+		TArray<uint16>& NewSlots = MagazineSlots.Add(WeaponMagazineClass);
+		for (int32 i = 0; i < Items.Entries.Num(); i++)
+		{
+			if (Items.Entries[i].ItemClass && Items.Entries[i].ItemClass->IsChildOf(WeaponMagazineClass))
+			{
+				NewSlots.Add((uint16)i);
+			}
+		}
+		Slots = &NewSlots;
+	}
+
+	int32 BestSlot = INDEX_NONE;
+	int32 BestCount = 0;
+	for (const uint16 Slot : *Slots)
+	{
+		if (Items.Entries[Slot].Count > BestCount)
+		{
+			BestSlot = Slot;
+			BestCount = Items.Entries[Slot].Count;
+		}
+	}
+
+	return BestSlot != INDEX_NONE ? TSubclassOf<APCMagazineBase>(*Items.Entries[BestSlot].ItemClass) : nullptr;
+}
+
+bool UInventoryComponent::ReloadMagazine(TSubclassOf<APCMagazineBase> WeaponMagazineClass, FPCMagazineState& Magazine)
+{
+	const bool bAuthority = GetOwnerRole() == ROLE_Authority;
+
+	// Rounds still in the magazine are put back before picking, a half empty magazine may still be the best one
+	if (bAuthority && Magazine.IsValid() && Magazine.RoundsRemaining > 0)
+	{
+		AddItem(Magazine.MagazineClass, Magazine.RoundsRemaining);
+		Magazine.Empty();
+	}
+
+	const TSubclassOf<APCMagazineBase> BestMagazine = FindBestMagazine(WeaponMagazineClass);
+	if (!BestMagazine)
+	{
+		return false;
+	}
+
+	// The owning client's counts don't have the old magazine's rounds put back yet
+	const bool bPredictReturnedRounds = !bAuthority && BestMagazine == Magazine.MagazineClass;
+
+	FPCMagazineState NewMagazine(BestMagazine);
+	const int32 Carried = GetCount(BestMagazine) + (bPredictReturnedRounds ? Magazine.RoundsRemaining : 0);
+	NewMagazine.RoundsRemaining = FMath::Min(NewMagazine.MaxCapacity, Carried);
+
+	if (bAuthority)
+	{
+		RemoveItem(BestMagazine, NewMagazine.RoundsRemaining);
+	}
+
+	Magazine = NewMagazine;
+
+	return Magazine.RoundsRemaining > 0;
+}
+
+void UInventoryComponent::OnEntryAdded(const FInventoryEntry& Entry)
+{
+	if (!bItemIdsDirty && Entry.ItemClass)
+	{
+		const uint16 ItemId = (uint16)(&Entry - Items.Entries.GetData());
+		ItemIds.Add(Entry.ItemClass, ItemId);
+
+		for (auto& Pair : MagazineSlots)
+		{
+			if (Entry.ItemClass->IsChildOf(Pair.Key))
+			{
+				Pair.Value.Add(ItemId);
+			}
+		}
+	}
+
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		OnInventoryChanged.Broadcast(this, Entry.ItemClass, Entry.Count);
+	}
+}
+
+void UInventoryComponent::OnEntryChanged(const FInventoryEntry& Entry)
+{
+	OnInventoryChanged.Broadcast(this, Entry.ItemClass, Entry.Count);
+}
+
+void UInventoryComponent::OnEntryRemoved()
+{
+	// Removed slots are swapped out after the callbacks, look everything up again afterwards
+	bItemIdsDirty = true;
+}
+
+void UInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Nobody else needs to know what we carry
+	DOREPLIFETIME_CONDITION(UInventoryComponent, Items, COND_OwnerOnly);
+}
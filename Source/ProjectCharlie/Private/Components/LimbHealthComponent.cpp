@@ -0,0 +1,295 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/LimbHealthComponent.h"
+#include "ProjectCharlie.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Net/UnrealNetwork.h"
+
+/*
+	Limb of every bone and physics body of one skeletal mesh, for one set
+	of limb definitions.
+*/
+struct FLimbBoneTable
+{
+	TWeakObjectPtr<USkeletalMesh> Mesh;
+	TWeakObjectPtr<UPhysicsAsset> PhysicsAsset;
+	TArray<uint8> LimbByBone; // Indexed by reference skeleton bone index
+	TArray<uint8> LimbByBody; // Indexed by physics body index (FHitResult::Item on skeletal mesh hits)
+};
+
+namespace
+{
+	// Shared by every component using the same mesh, physics asset and limbs
+	TMap<uint32, TSharedPtr<const FLimbBoneTable>> LimbBoneTables;
+
+	uint32 GetLimbTableKey(const USkeletalMesh* Mesh, const UPhysicsAsset* PhysicsAsset, const TArray<FLimbDefinition>& Limbs)
+	{
+		uint32 Key = HashCombine(PointerHash(Mesh), PointerHash(PhysicsAsset));
+		for (const FLimbDefinition& Limb : Limbs)
+		{
+			for (const FName& Bone : Limb.Bones)
+			{
+				Key = HashCombine(Key, GetTypeHash(Bone));
+			}
+			Key = HashCombine(Key, Limb.Bones.Num());
+		}
+		return Key;
+	}
+
+	uint8 QuantizeLimbHealth(float Health, float MaxHealth)
+	{
+		// Round up so a limb only reads as zero once it really is
+		return MaxHealth > 0.0f ? (uint8)FMath::Clamp(FMath::CeilToInt(Health / MaxHealth * 255.0f), 0, 255) : 0;
+	}
+}
+
+ULimbHealthComponent::ULimbHealthComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	SetIsReplicated(true);
+
+	MeshComp = nullptr;
+
+	// Default limbs for the UE4 mannequin skeleton
+	FLimbDefinition Head;
+	Head.Name = TEXT("Head");
+	Head.Bones.Add(TEXT("neck_01"));
+	Head.DamageMultiplier = 4.0f;
+	Limbs.Add(Head);
+
+	FLimbDefinition Torso;
+	Torso.Name = TEXT("Torso");
+	Torso.Bones.Add(TEXT("pelvis"));
+	Torso.MaxHealth = 150.0f;
+	Limbs.Add(Torso);
+
+	FLimbDefinition LeftArm;
+	LeftArm.Name = TEXT("LeftArm");
+	LeftArm.Bones.Add(TEXT("clavicle_l"));
+	LeftArm.DamageMultiplier = 0.75f;
+	Limbs.Add(LeftArm);
+
+	FLimbDefinition RightArm;
+	RightArm.Name = TEXT("RightArm");
+	RightArm.Bones.Add(TEXT("clavicle_r"));
+	RightArm.DamageMultiplier = 0.75f;
+	Limbs.Add(RightArm);
+
+	FLimbDefinition LeftLeg;
+	LeftLeg.Name = TEXT("LeftLeg");
+	LeftLeg.Bones.Add(TEXT("thigh_l"));
+	LeftLeg.DamageMultiplier = 0.75f;
+	Limbs.Add(LeftLeg);
+
+	FLimbDefinition RightLeg;
+	RightLeg.Name = TEXT("RightLeg");
+	RightLeg.Bones.Add(TEXT("thigh_r"));
+	RightLeg.DamageMultiplier = 0.75f;
+	Limbs.Add(RightLeg);
+}
+
+void ULimbHealthComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Limbs are indexed with a byte and NoLimb is reserved
+	if (Limbs.Num() >= NoLimb)
+	{
+		Limbs.SetNum(NoLimb - 1);
+	}
+
+	if (AActor* MyOwner = GetOwner())
+	{
+		MeshComp = MyOwner->FindComponentByClass<USkeletalMeshComponent>();
+	}
+
+	BuildBoneTable();
+
+	LimbHealthValues.SetNum(Limbs.Num());
+	LimbHealth.SetNum(Limbs.Num());
+	for (int32 i = 0; i < Limbs.Num(); i++)
+	{
+		LimbHealthValues[i] = Limbs[i].MaxHealth;
+		LimbHealth[i] = QuantizeLimbHealth(LimbHealthValues[i], Limbs[i].MaxHealth);
+	}
+	PreviousLimbHealth = LimbHealth;
+}
+
+/*
+	BuildBoneTable
+	======================================================================
+	Finds or builds the limb table for our mesh. Parents always come
+	before their children in the reference skeleton, so one pass lets
+	every bone inherit the limb of its nearest limb root.
+	======================================================================
+*/
+void ULimbHealthComponent::BuildBoneTable()
+{
+	USkeletalMesh* Mesh = MeshComp ? MeshComp->SkeletalMesh : nullptr;
+	if (!Mesh)
+	{
+		BoneTable.Reset();
+		return;
+	}
+
+	UPhysicsAsset* PhysicsAsset = MeshComp->GetPhysicsAsset();
+	const uint32 Key = GetLimbTableKey(Mesh, PhysicsAsset, Limbs);
+
+	const TSharedPtr<const FLimbBoneTable>* Existing = LimbBoneTables.Find(Key);
+	if (Existing && (*Existing)->Mesh.Get() == Mesh && (*Existing)->PhysicsAsset.Get() == PhysicsAsset)
+	{
+		BoneTable = *Existing;
+		return;
+	}
+
+	// Drop tables whose mesh was unloaded before adding another
+	for (auto It = LimbBoneTables.CreateIterator(); It; ++It)
+	{
+		if (!It.Value()->Mesh.IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	TSharedPtr<FLimbBoneTable> Table = MakeShareable(new FLimbBoneTable());
+	Table->Mesh = Mesh;
+	Table->PhysicsAsset = PhysicsAsset;
+
+	const FReferenceSkeleton& RefSkeleton = Mesh->RefSkeleton;
+	const int32 NumBones = RefSkeleton.GetNum();
+
+	Table->LimbByBone.Init(NoLimb, NumBones);
+	for (int32 LimbIndex = 0; LimbIndex < Limbs.Num(); LimbIndex++)
+	{
+		for (const FName& BoneName : Limbs[LimbIndex].Bones)
+		{
+			const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+			if (BoneIndex != INDEX_NONE)
+			{
+				Table->LimbByBone[BoneIndex] = (uint8)LimbIndex;
+			}
+		}
+	}
+
+	for (int32 BoneIndex = 1; BoneIndex < NumBones; BoneIndex++)
+	{
+		if (Table->LimbByBone[BoneIndex] == NoLimb)
+		{
+			Table->LimbByBone[BoneIndex] = Table->LimbByBone[RefSkeleton.GetParentIndex(BoneIndex)];
+		}
+	}
+
+	if (PhysicsAsset)
+	{
+		const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+		Table->LimbByBody.Init(NoLimb, NumBodies);
+		for (int32 BodyIndex = 0; BodyIndex < NumBodies; BodyIndex++)
+		{
+			const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+			const int32 BoneIndex = BodySetup ? RefSkeleton.FindBoneIndex(BodySetup->BoneName) : INDEX_NONE;
+			if (BoneIndex != INDEX_NONE)
+			{
+				Table->LimbByBody[BodyIndex] = Table->LimbByBone[BoneIndex];
+			}
+		}
+	}
+
+	LimbBoneTables.Add(Key, Table);
+	BoneTable = Table;
+}
+
+uint8 ULimbHealthComponent::FindLimb(const FHitResult& Hit) const
+{
+	if (!BoneTable.IsValid() || !MeshComp || Hit.Component.Get() != MeshComp)
+	{
+		return NoLimb;
+	}
+
+	// Traces against the physics asset report the body they hit
+	if (BoneTable->LimbByBody.IsValidIndex(Hit.Item))
+	{
+		return BoneTable->LimbByBody[Hit.Item];
+	}
+
+	// Damage that only knows the bone (hand built hit results)
+	if (Hit.BoneName != NAME_None)
+	{
+		const int32 BoneIndex = MeshComp->GetBoneIndex(Hit.BoneName);
+		if (BoneTable->LimbByBone.IsValidIndex(BoneIndex))
+		{
+			return BoneTable->LimbByBone[BoneIndex];
+		}
+	}
+
+	return NoLimb;
+}
+
+/*
+	ApplyPointDamage
+	======================================================================
+	Takes the scaled damage off the limb that was hit. Hits outside of
+	every limb are passed through unscaled.
+	======================================================================
+*/
+float ULimbHealthComponent::ApplyPointDamage(const FHitResult& Hit, float Damage)
+{
+	const uint8 LimbIndex = FindLimb(Hit);
+	if (Damage <= 0.0f || !LimbHealthValues.IsValidIndex(LimbIndex))
+	{
+		return Damage;
+	}
+
+	const FLimbDefinition& Limb = Limbs[LimbIndex];
+	const float ScaledDamage = Damage * Limb.DamageMultiplier;
+
+	LimbHealthValues[LimbIndex] = FMath::Max(LimbHealthValues[LimbIndex] - ScaledDamage, 0.0f);
+	LimbHealth[LimbIndex] = QuantizeLimbHealth(LimbHealthValues[LimbIndex], Limb.MaxHealth);
+
+	OnLimbHealthChanged.Broadcast(this, LimbIndex, LimbHealthValues[LimbIndex]);
+
+	return ScaledDamage;
+}
+
+void ULimbHealthComponent::OnRep_LimbHealth()
+{
+	for (int32 i = 0; i < LimbHealth.Num() && i < Limbs.Num(); i++)
+	{
+		if (!PreviousLimbHealth.IsValidIndex(i) || PreviousLimbHealth[i] != LimbHealth[i])
+		{
+			OnLimbHealthChanged.Broadcast(this, i, GetLimbHealth(i));
+		}
+	}
+
+	PreviousLimbHealth = LimbHealth;
+}
+
+float ULimbHealthComponent::GetLimbHealth(int32 LimbIndex) const
+{
+	if (LimbHealthValues.IsValidIndex(LimbIndex) && GetOwnerRole() == ROLE_Authority)
+	{
+		return LimbHealthValues[LimbIndex];
+	}
+
+	if (LimbHealth.IsValidIndex(LimbIndex) && Limbs.IsValidIndex(LimbIndex))
+	{
+		return LimbHealth[LimbIndex] / 255.0f * Limbs[LimbIndex].MaxHealth;
+	}
+
+	return 0.0f;
+}
+
+int32 ULimbHealthComponent::GetLimbIndex(FName LimbName) const
+{
+	return Limbs.IndexOfByPredicate([LimbName](const FLimbDefinition& Limb) { return Limb.Name == LimbName; });
+}
+
+void ULimbHealthComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ULimbHealthComponent, LimbHealth);
+}
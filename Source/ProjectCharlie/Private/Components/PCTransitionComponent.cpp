@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/PCTransitionComponent.h"
+#include "ProjectCharlie.h"
+#include "Systems/PCTickManager.h"
+#include "Curves/CurveFloat.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active Transitions"), STAT_ActiveTransitions, STATGROUP_ProjectCharlie);
+
+UPCTransitionComponent::UPCTransitionComponent()
+{
+	// Ticked in a batch by APCTickManager
+	PrimaryComponentTick.bCanEverTick = false;
+
+	DefaultEaseExponent = 3.0f;
+	bRegisteredTick = false;
+}
+
+/*
+	StartTransition
+	======================================================================
+	Start (or restart) the named transition and wake the component up.
+	A zero duration applies the end state and finishes immediately.
+	======================================================================
+*/
+void UPCTransitionComponent::StartTransition(FName Name, float Duration, UCurveFloat* Curve, TFunction<void(float)> Apply, TFunction<void()> OnFinished)
+{
+	Transitions.RemoveAllSwap([Name](const FPCTransition& Transition) { return Transition.Name == Name; });
+
+	FPCTransition Transition;
+	Transition.Name = Name;
+	Transition.Duration = Duration;
+	Transition.Elapsed = 0.0f;
+	Transition.Curve = Curve;
+	Transition.Apply = MoveTemp(Apply);
+	Transition.OnFinished = MoveTemp(OnFinished);
+
+	if (Duration <= 0.0f)
+	{
+		Transition.Elapsed = Duration;
+
+		if (Transition.Apply)
+		{
+			Transition.Apply(EvaluateAlpha(Transition));
+		}
+		if (Transition.OnFinished)
+		{
+			Transition.OnFinished();
+		}
+		return;
+	}
+
+	Transitions.Add(MoveTemp(Transition));
+	SetManagedTickEnabled(true);
+
+	// No tick manager outside of game worlds, jump straight to the end
+	if (!bRegisteredTick)
+	{
+		StopTransition(Name, true);
+	}
+}
+
+void UPCTransitionComponent::StopTransition(FName Name, bool bFinish)
+{
+	const int32 Index = Transitions.IndexOfByPredicate([Name](const FPCTransition& Transition) { return Transition.Name == Name; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	FPCTransition Transition = MoveTemp(Transitions[Index]);
+	Transitions.RemoveAtSwap(Index);
+
+	if (Transitions.Num() == 0)
+	{
+		SetManagedTickEnabled(false);
+	}
+
+	if (bFinish)
+	{
+		Transition.Elapsed = Transition.Duration;
+
+		if (Transition.Apply)
+		{
+			Transition.Apply(EvaluateAlpha(Transition));
+		}
+		if (Transition.OnFinished)
+		{
+			Transition.OnFinished();
+		}
+	}
+}
+
+bool UPCTransitionComponent::IsTransitionActive(FName Name) const
+{
+	return Transitions.ContainsByPredicate([Name](const FPCTransition& Transition) { return Transition.Name == Name; });
+}
+
+bool UPCTransitionComponent::HasActiveTransitions() const
+{
+	return Transitions.Num() > 0;
+}
+
+/*
+	ManagedTick
+	======================================================================
+	Advance every running transition. Finished ones are removed before
+	their callbacks run so a callback can safely start a new transition.
+	======================================================================
+*/
+void UPCTransitionComponent::ManagedTick(float DeltaTime)
+{
+	INC_DWORD_STAT_BY(STAT_ActiveTransitions, Transitions.Num());
+
+	TArray<TFunction<void()>, TInlineAllocator<4>> Finished;
+
+	for (int32 Index = Transitions.Num() - 1; Index >= 0; --Index)
+	{
+		FPCTransition& Transition = Transitions[Index];
+		Transition.Elapsed = FMath::Min(Transition.Elapsed + DeltaTime, Transition.Duration);
+
+		if (Transition.Apply)
+		{
+			Transition.Apply(EvaluateAlpha(Transition));
+		}
+
+		if (Transition.Elapsed >= Transition.Duration)
+		{
+			if (Transition.OnFinished)
+			{
+				Finished.Add(MoveTemp(Transition.OnFinished));
+			}
+			Transitions.RemoveAtSwap(Index);
+		}
+	}
+
+	for (TFunction<void()>& OnFinished : Finished)
+	{
+		OnFinished();
+	}
+
+	// Idle owners cost nothing until the next state change
+	if (Transitions.Num() == 0)
+	{
+		SetManagedTickEnabled(false);
+	}
+}
+
+void UPCTransitionComponent::SetManagedTickEnabled(bool bEnabled)
+{
+	if (bEnabled == bRegisteredTick)
+	{
+		return;
+	}
+
+	if (bEnabled)
+	{
+		if (APCTickManager* TickManager = APCWorldManager::Get<APCTickManager>(this))
+		{
+			TickManager->RegisterTick(this);
+			bRegisteredTick = true;
+		}
+	}
+	else
+	{
+		if (APCTickManager* TickManager = APCWorldManager::Find<APCTickManager>(this))
+		{
+			TickManager->UnregisterTick(this);
+		}
+		bRegisteredTick = false;
+	}
+}
+
+void UPCTransitionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Transitions.Reset();
+	SetManagedTickEnabled(false);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+float UPCTransitionComponent::EvaluateAlpha(const FPCTransition& Transition) const
+{
+	const float Time = Transition.Duration > 0.0f ? FMath::Clamp(Transition.Elapsed / Transition.Duration, 0.0f, 1.0f) : 1.0f;
+
+	if (UCurveFloat* Curve = Transition.Curve.Get())
+	{
+		return Curve->GetFloatValue(Time);
+	}
+
+	return FMath::InterpEaseOut(0.0f, 1.0f, Time, DefaultEaseExponent);
+}
@@ -2,12 +2,13 @@
 
 #include "InteractableObject.h"
 #include "Components/StaticMeshComponent.h"
+#include "Systems/PCInteractableRegistry.h"
 
 // Sets default values
 AInteractableObject::AInteractableObject()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Nothing to do per frame
+	PrimaryActorTick.bCanEverTick = false;
 
 	SceneComp = CreateDefaultSubobject<USceneComponent>(TEXT("SceneComp"));
 	RootComponent = SceneComp;
@@ -23,10 +24,15 @@ void AInteractableObject::BeginPlay()
 	Super::BeginPlay();
 }
 
-// Called every frame
-void AInteractableObject::Tick(float DeltaTime)
+void AInteractableObject::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	// The registry picks interactables up by itself but only notices destroyed ones lazily
+	if (APCInteractableRegistry* Registry = APCWorldManager::Find<APCInteractableRegistry>(this))
+	{
+		Registry->UnregisterInteractable(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,7 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PCCharacter.h"
+#include "ProjectCharlie.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
@@ -13,6 +14,168 @@
 #include "TimerManager.h"
 #include "Animation/AnimInstance.h"
 #include "PCWeaponBase.h"
+#include "Components/PCTransitionComponent.h"
+#include "Components/LimbHealthComponent.h"
+#include "Components/InventoryComponent.h"
+#include "Engine/DamageEvents.h"
+#include "Systems/PCTickManager.h"
+#include "Systems/PCReplicationGraph.h"
+#include "Systems/PCLagCompensationManager.h"
+#include "Systems/PCLoadoutSpawner.h"
+#include "Systems/PCInteractableRegistry.h"
+#include "GameFramework/GameStateBase.h"
+
+//Interact Debug Command
+static int32 DebugInteractDrawing = 0;
+FAutoConsoleVariableRef CVARDebugInteractDrawing(TEXT("PC.DebugInteract"), DebugInteractDrawing, TEXT("Draw the interact view and the focused interactable"), ECVF_Cheat);
+
+namespace
+{
+	const FName TransitionName_WeaponAim = TEXT("WeaponAim");
+	const FName TransitionName_Lean = TEXT("Lean");
+	const FName TransitionName_Peak = TEXT("Peak");
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPCCharacterNetState
+
+namespace
+{
+	enum ENetStateFlags : uint8
+	{
+		NETSTATE_Sprinting = 1 << 0,
+		NETSTATE_Aiming = 1 << 1,
+		NETSTATE_FirstPerson = 1 << 2,
+		NETSTATE_Leaning = 1 << 3,
+		NETSTATE_Peaking = 1 << 4,
+		NETSTATE_WeaponEquipped = 1 << 5
+	};
+
+	const uint32 NetStateFlagBits = 6;
+}
+
+FPCCharacterNetState::FPCCharacterNetState()
+	: bIsSprinting(false)
+	, bIsAiming(false)
+	, bIsFirstPerson(false)
+	, bIsWeaponEquipped(false)
+	, Lean(0)
+	, Peak(0)
+{
+}
+
+void FPCCharacterNetState::SetLean(float Alpha)
+{
+	Lean = (int8)FMath::RoundToInt(FMath::Clamp(Alpha, -1.0f, 1.0f) * 127.0f);
+}
+
+float FPCCharacterNetState::GetLean() const
+{
+	return Lean / 127.0f;
+}
+
+void FPCCharacterNetState::SetPeak(float Alpha)
+{
+	Peak = (uint8)FMath::RoundToInt(FMath::Clamp(Alpha, 0.0f, 1.0f) * 255.0f);
+}
+
+float FPCCharacterNetState::GetPeak() const
+{
+	return Peak / 255.0f;
+}
+
+bool FPCCharacterNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Flags = 0;
+
+	if (Ar.IsSaving())
+	{
+		Flags |= bIsSprinting ? NETSTATE_Sprinting : 0;
+		Flags |= bIsAiming ? NETSTATE_Aiming : 0;
+		Flags |= bIsFirstPerson ? NETSTATE_FirstPerson : 0;
+		Flags |= bIsWeaponEquipped ? NETSTATE_WeaponEquipped : 0;
+		Flags |= Lean != 0 ? NETSTATE_Leaning : 0;
+		Flags |= Peak != 0 ? NETSTATE_Peaking : 0;
+	}
+
+	Ar.SerializeBits(&Flags, NetStateFlagBits);
+
+	if (Ar.IsLoading())
+	{
+		bIsSprinting = (Flags & NETSTATE_Sprinting) != 0;
+		bIsAiming = (Flags & NETSTATE_Aiming) != 0;
+		bIsFirstPerson = (Flags & NETSTATE_FirstPerson) != 0;
+		bIsWeaponEquipped = (Flags & NETSTATE_WeaponEquipped) != 0;
+		Lean = 0;
+		Peak = 0;
+	}
+
+	// Amounts only when set, an idle character costs just the flag bits
+	if (Flags & NETSTATE_Leaning)
+	{
+		Ar << Lean;
+	}
+
+	if (Flags & NETSTATE_Peaking)
+	{
+		Ar << Peak;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+bool FPCCharacterNetState::operator==(const FPCCharacterNetState& Other) const
+{
+	return bIsSprinting == Other.bIsSprinting
+		&& bIsAiming == Other.bIsAiming
+		&& bIsFirstPerson == Other.bIsFirstPerson
+		&& bIsWeaponEquipped == Other.bIsWeaponEquipped
+		&& Lean == Other.Lean
+		&& Peak == Other.Peak;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPCCharacterEventStream
+
+namespace
+{
+	const uint32 EventTypeBits = 3;
+	const uint32 EventCountBits = 5;
+}
+
+void FPCCharacterEventStream::Push(EPCCharacterEvent Type, uint8 Count)
+{
+	FPCCharacterEventEntry& Event = Events[NextSequence % Capacity];
+	Event.Type = Type;
+	Event.Count = FMath::Min(Count, MaxFireCount);
+
+	NextSequence++;
+}
+
+bool FPCCharacterEventStream::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << NextSequence;
+
+	for (FPCCharacterEventEntry& Event : Events)
+	{
+		uint8 Type = (uint8)Event.Type;
+		Ar.SerializeBits(&Type, EventTypeBits);
+		Event.Type = (EPCCharacterEvent)Type;
+
+		if (Event.Type == EPCCharacterEvent::FIRE)
+		{
+			Ar.SerializeBits(&Event.Count, EventCountBits);
+		}
+		else if (Ar.IsLoading())
+		{
+			Event.Count = 0;
+		}
+	}
+
+	bOutSuccess = true;
+	return true;
+}
 
 //////////////////////////////////////////////////////////////////////////
 // APCCharacter
@@ -23,9 +186,20 @@ APCCharacter::APCCharacter()
 		Initialize Values/Flags/etc.
 		----------------------------------------------------------------
 	*/
-	PrimaryActorTick.bCanEverTick = true;
+	// Smoothing is event driven through the transition component, nothing to do per frame
+	PrimaryActorTick.bCanEverTick = false;
 	NetUpdateFrequency = 30.0f;
-	MinNetUpdateFrequency = 15.0f;
+	MinNetUpdateFrequency = 2.0f;
+	ActiveNetUpdateFrequency = 30.0f;
+	MovingNetUpdateFrequency = 15.0f;
+	IdleNetUpdateFrequency = 2.0f;
+	NetActivityHoldTime = 2.0f;
+	NetUpdateDecayTime = 3.0f;
+	NetPriorityFullDistance = 3000.0f;
+	LastNetActivityTime = -BIG_NUMBER;
+	LastEventSequence = 0;
+	bEventStreamSynced = false;
+	PendingFireShots = 0;
 
 	bIsWeaponEquipped = false;
 	bIsRifleEquipped = false;
@@ -41,6 +215,11 @@ APCCharacter::APCCharacter()
 	bIsPeaking = false;
 	LeanAmount = 0;
 	PeakAmount = 0;
+	LeanTime = 0.6f;
+	AimInTime = 0.3f;
+	AimOutTime = 0.6f;
+	InteractConeAngle = 15.0f;
+	bConfirmInteractTrace = true;
 
 	GetCharacterMovement()->NavAgentProps.bCanCrouch = true;
 	GetCharacterMovement()->MaxWalkSpeed = BaseWalkSpeed;
@@ -56,6 +235,10 @@ APCCharacter::APCCharacter()
 		Initialize Components
 		----------------------------------------------------------------
 	*/
+	TransitionComp = CreateDefaultSubobject<UPCTransitionComponent>(TEXT("TransitionComp"));
+	LimbHealthComp = nullptr;
+	InventoryComp = nullptr;
+
 	// Configure character movement
 	GetCharacterMovement()->bOrientRotationToMovement = true; // Character moves in the direction of input...	
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 540.0f, 0.0f); // ...at this rotation rate
@@ -77,53 +260,587 @@ void APCCharacter::BeginPlay()
 	// Get the Player's Anim Instance and Set to Class Variable
 	//AnimInstance = GetMesh()->GetAnimInstance();
 
+	LimbHealthComp = FindComponentByClass<ULimbHealthComponent>();
+	InventoryComp = FindComponentByClass<UInventoryComponent>();
+
 	GetCharacterMovement()->MaxWalkSpeed = BaseWalkSpeed;
 	GetCharacterMovement()->MaxWalkSpeedCrouched = MaxCrouchSpeed;
 
-	// If a primary weapon is specified, spawn it in the "holster"
-	if (PrimaryWeaponClass)
+	// Weapons are loaded and spawned over the next frames, until then the character is unarmed
+	if (APCLoadoutSpawner* LoadoutSpawner = APCWorldManager::Get<APCLoadoutSpawner>(this))
+	{
+		LoadoutSpawner->RequestWeapon(this, PrimaryWeaponClass, EPCLoadoutSlot::PRIMARY);
+		LoadoutSpawner->RequestWeapon(this, SecondaryWeaponClass, EPCLoadoutSlot::SECONDARY);
+	}
+
+	// Adapt the net update rate to what the character is doing, only the server sends updates
+	if (Role == ROLE_Authority && GetNetMode() != NM_Standalone)
+	{
+		OnTakeAnyDamage.AddDynamic(this, &APCCharacter::HandleTakeAnyDamageNetActivity);
+		NotifyNetActivity();
+
+		if (APCTickManager* TickManager = APCWorldManager::Get<APCTickManager>(this))
+		{
+			TickManager->RegisterTick(this);
+		}
+
+		// Keep a hitbox history so client reported hits can be checked against it
+		if (APCLagCompensationManager* LagCompensation = APCWorldManager::Get<APCLagCompensationManager>(this))
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+	}
+}
+
+/*
+	OnLoadoutWeaponSpawned
+	======================================================================
+	Puts a newly spawned loadout weapon in its holster. If the weapon was
+	equipped while it was still on its way, the equip is finished now.
+	======================================================================
+*/
+void APCCharacter::OnLoadoutWeaponSpawned(EPCLoadoutSlot Slot, APCWeaponBase* Weapon)
+{
+	Weapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, Weapon->GetHolsterSocketName());
+
+	if (Slot == EPCLoadoutSlot::PRIMARY)
+	{
+		PrimaryWeapon = Weapon;
+	}
+	else
+	{
+		SecondaryWeapon = Weapon;
+	}
+
+	if (InventoryComp && Role == ROLE_Authority)
+	{
+		InventoryComp->AddItem(Weapon->GetClass(), 1);
+	}
+
+	if (Slot == EPCLoadoutSlot::PRIMARY && bIsWeaponEquipped && !CurrentWeapon)
+	{
+		EquipWeapon(Weapon);
+	}
+}
+
+void APCCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (APCTickManager* TickManager = APCWorldManager::Find<APCTickManager>(this))
+	{
+		TickManager->UnregisterTick(this);
+	}
+
+	if (APCLagCompensationManager* LagCompensation = APCWorldManager::Find<APCLagCompensationManager>(this))
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+/*
+	NotifyNetActivity
+	======================================================================
+	Something worth replicating promptly happened (firing, aiming,
+	sprinting, taking damage). Jump straight to the active update rate
+	and push an update out now. ManagedTick decays it again later.
+	======================================================================
+*/
+void APCCharacter::NotifyNetActivity()
+{
+	if (Role != ROLE_Authority)
+	{
+		return;
+	}
+
+	LastNetActivityTime = GetWorld()->TimeSeconds;
+
+	if (NetUpdateFrequency < ActiveNetUpdateFrequency)
 	{
-		FActorSpawnParameters PWSpawnParams;
-		PWSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		PrimaryWeapon = GetWorld()->SpawnActor<APCWeaponBase>(PrimaryWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, PWSpawnParams);
-		PrimaryWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, PrimaryWeapon->GetHolsterSocketName());
+		SetAdaptiveNetUpdateFrequency(ActiveNetUpdateFrequency);
+		ForceNetUpdate();
 	}
+}
+
+void APCCharacter::SetAdaptiveNetUpdateFrequency(float NewFrequency)
+{
+	if (FMath::IsNearlyEqual(NetUpdateFrequency, NewFrequency))
+	{
+		return;
+	}
+
+	NetUpdateFrequency = NewFrequency;
+	UPCReplicationGraph::NotifyNetUpdateFrequencyChanged(this);
+}
+
+/*
+	UpdateNetState
+	======================================================================
+	Called after any local change to sprint/aim/lean/peak/view. The
+	owning client sends the new state to the server, the server
+	replicates it to everyone else.
+	======================================================================
+*/
+void APCCharacter::UpdateNetState()
+{
+	const FPCCharacterNetState NewState = BuildNetState();
+	if (NewState == NetState)
+	{
+		return;
+	}
+
+	NetState = NewState;
+
+	if (Role == ROLE_Authority)
+	{
+		NotifyNetActivity();
+	}
+	else if (Role == ROLE_AutonomousProxy)
+	{
+		ServerSetNetState(NewState);
+	}
+}
+
+FPCCharacterNetState APCCharacter::BuildNetState()
+{
+	FPCCharacterNetState State;
+	State.bIsSprinting = bIsSprinting;
+	State.bIsAiming = bIsAiming;
+	State.bIsWeaponEquipped = bIsWeaponEquipped;
+	State.SetLean(MaxLean > 0.0f ? GetLeanAmount() / MaxLean : 0.0f);
+	State.SetPeak(MaxPeak > 0.0f ? GetPeakAmount() / MaxPeak : 0.0f);
+	return State;
+}
+
+/*
+	ApplyNetState
+	======================================================================
+	Take on replicated state. Movement speed follows so the server's
+	movement simulation agrees with the owner, and the lean, peak and
+	ADS blends are started locally from the new targets.
+	======================================================================
+*/
+void APCCharacter::ApplyNetState(const FPCCharacterNetState& NewState, const FPCCharacterNetState& OldState)
+{
+	// Before anything else so the aim transition below has a weapon to work with
+	if (NewState.bIsWeaponEquipped != bIsWeaponEquipped)
+	{
+		SetWeaponEquipped(NewState.bIsWeaponEquipped);
+	}
+
+	bIsSprinting = NewState.bIsSprinting;
+	bIsAiming = NewState.bIsAiming;
+
+	if (bIsSprinting)
+	{
+		GetCharacterMovement()->MaxWalkSpeed = MaxSprintSpeed;
+	}
+	else
+	{
+		GetCharacterMovement()->MaxWalkSpeed = bIsAiming ? AimWalkSpeed : BaseWalkSpeed;
+	}
+	GetCharacterMovement()->SetJumpAllowed(!bIsAiming);
+
+	if (NewState.Lean != OldState.Lean)
+	{
+		bIsLeaningLeft = NewState.Lean < 0;
+		bIsLeaningRight = NewState.Lean > 0;
+		StartLeanTransition(NewState.GetLean() * MaxLean);
+	}
+
+	if (NewState.Peak != OldState.Peak)
+	{
+		bIsPeaking = NewState.Peak > 0;
+		StartPeakTransition(NewState.GetPeak() * MaxPeak);
+	}
+
+	if (NewState.bIsAiming != OldState.bIsAiming)
+	{
+		bDoingSmoothAim = bIsAiming;
+		bDoingSmoothStopAimWeapon = !bIsAiming;
+		StartWeaponAimTransition(bIsAiming);
+	}
+}
+
+void APCCharacter::ServerSetNetState_Implementation(FPCCharacterNetState NewState)
+{
+	// The equipped weapon only changes through ServerSetWeaponEquipped
+	NewState.bIsWeaponEquipped = bIsWeaponEquipped;
+
+	const FPCCharacterNetState OldState = NetState;
+	NetState = NewState;
+
+	ApplyNetState(NewState, OldState);
+	NotifyNetActivity();
+}
+
+bool APCCharacter::ServerSetNetState_Validate(FPCCharacterNetState NewState)
+{
+	return true;
+}
+
+void APCCharacter::OnRep_NetState(FPCCharacterNetState OldState)
+{
+	ApplyNetState(NetState, OldState);
+}
+
+void APCCharacter::PushCharacterEvent(EPCCharacterEvent Type, uint8 Count)
+{
+	if (Role != ROLE_Authority)
+	{
+		return;
+	}
+
+	EventStream.Push(Type, Count);
+	NotifyNetActivity();
+}
+
+/*
+	OnRep_EventStream
+	======================================================================
+	Replay every event we have not seen yet, oldest first. When we first
+	receive the stream or fell more than a buffer behind, nothing is
+	replayed: old reloads and shots are not worth playing late, and the
+	equip state comes from the net state instead.
+	======================================================================
+*/
+void APCCharacter::OnRep_EventStream()
+{
+	const uint16 NextSequence = EventStream.NextSequence;
+	const uint16 Missed = NextSequence - LastEventSequence;
 
-	// If a secondary weapon is specified, spawn it in the "holster"
-	if (SecondaryWeaponClass)
+	if (bEventStreamSynced && Missed <= FPCCharacterEventStream::Capacity)
 	{
-		FActorSpawnParameters SWSpawnParams;
-		SWSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		SecondaryWeapon = GetWorld()->SpawnActor<APCWeaponBase>(SecondaryWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SWSpawnParams);
-		SecondaryWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, SecondaryWeapon->GetHolsterSocketName());
+		for (uint16 Sequence = LastEventSequence; Sequence != NextSequence; Sequence++)
+		{
+			HandleCharacterEvent(EventStream.Get(Sequence));
+		}
+	}
+
+	LastEventSequence = NextSequence;
+	bEventStreamSynced = true;
+}
+
+void APCCharacter::HandleCharacterEvent(const FPCCharacterEventEntry& Event)
+{
+	switch (Event.Type)
+	{
+	case EPCCharacterEvent::RELOAD:
+		PlayReloadAnimation();
+		break;
+
+	case EPCCharacterEvent::FIRE:
+		if (CurrentWeapon && bIsWeaponEquipped)
+		{
+			CurrentWeapon->PlayRemoteFireEffects(Event.Count);
+		}
+		break;
+
+	default:
+		break;
 	}
 }
 
 /*
-	Tick
+	NotifyWeaponFired
 	======================================================================
-	Called every game tick.
-	Currently used for smooth transitions.
+	Gather the shot and send all of this frame's shots together next
+	tick. The server counts them into one FIRE event, an owning client
+	sends the predicted shots to the server as one batch.
 	======================================================================
 */
-void APCCharacter::Tick(float DeltaTime)
+void APCCharacter::NotifyWeaponFired(const FPCShotRecord& Shot)
 {
-	Super::Tick(DeltaTime);
+	if (Role == ROLE_Authority)
+	{
+		if (PendingFireShots < FPCCharacterEventStream::MaxFireCount)
+		{
+			PendingFireShots++;
+		}
+	}
+	else if (IsLocallyControlled() && PendingShots.Num() < MaxShotsPerBatch)
+	{
+		PendingShots.Add(Shot);
+	}
+	else
+	{
+		return;
+	}
 
-	// Smooth ADS Weapon Position
-	if (bIsWeaponEquipped && bIsAiming && CurrentWeaponMesh && bDoingSmoothAim)
+	if (!GetWorldTimerManager().IsTimerActive(TimerHandle_FlushFireEvents))
 	{
-		CurrentWeaponMesh->SetRelativeLocation(FMath::VInterpTo(CurrentWeaponMesh->RelativeLocation, CurrentWeapon->GetAimLocation(), DeltaTime, 11.0f));
-		CurrentWeaponMesh->SetRelativeRotation(FMath::RInterpTo(CurrentWeaponMesh->RelativeRotation, CurrentWeapon->GetAimRotation(), DeltaTime, 11.0f));
+		TimerHandle_FlushFireEvents = GetWorldTimerManager().SetTimerForNextTick(this, &APCCharacter::FlushFireEvents);
 	}
-	else if (bIsWeaponEquipped && !bIsAiming && CurrentWeaponMesh && bDoingSmoothStopAimWeapon)
+}
+
+void APCCharacter::FlushFireEvents()
+{
+	if (PendingFireShots > 0)
 	{
-		CurrentWeaponMesh->SetRelativeLocation(FMath::VInterpTo(CurrentWeaponMesh->RelativeLocation, CurrentWeapon->GetHipLocation(), DeltaTime, 5.0f));
-		CurrentWeaponMesh->SetRelativeRotation(FMath::RInterpTo(CurrentWeaponMesh->RelativeRotation, CurrentWeapon->GetHipRotation(), DeltaTime, 5.0f));
+		PushCharacterEvent(EPCCharacterEvent::FIRE, PendingFireShots);
+		PendingFireShots = 0;
 	}
 
-	LeanAmount = FMath::FInterpTo(LeanAmount, GetLeanAmount(), DeltaTime, 5.0f);
-	PeakAmount = FMath::FInterpTo(PeakAmount, GetPeakAmount(), DeltaTime, 5.0f);
+	if (PendingShots.Num() > 0)
+	{
+		ServerFireShots(PendingShots);
+		PendingShots.Reset();
+	}
+}
+
+/*
+	ServerFireShots
+	======================================================================
+	Fires the client's predicted shots again on our copy of the weapon,
+	which checks ammo, fire rate and origin before spawning anything.
+	The client gets one ack per batch with the shots we refused and the
+	ammo we ended up with.
+	======================================================================
+*/
+void APCCharacter::ServerFireShots_Implementation(const TArray<FPCShotRecord>& Shots)
+{
+	if (Shots.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<uint16> RejectedSequences;
+
+	for (const FPCShotRecord& Shot : Shots)
+	{
+		if (!CurrentWeapon || !bIsWeaponEquipped || !CurrentWeapon->ServerFireShot(Shot))
+		{
+			RejectedSequences.Add(Shot.Sequence);
+		}
+	}
+
+	ClientAckShots(Shots.Last().Sequence, RejectedSequences, CurrentWeapon ? CurrentWeapon->GetMagazine().RoundsRemaining : 0);
+}
+
+bool APCCharacter::ServerFireShots_Validate(const TArray<FPCShotRecord>& Shots)
+{
+	return Shots.Num() <= MaxShotsPerBatch;
+}
+
+void APCCharacter::ClientAckShots_Implementation(uint16 AckedSequence, const TArray<uint16>& RejectedSequences, int32 RoundsRemaining)
+{
+	if (CurrentWeapon)
+	{
+		CurrentWeapon->ReconcileShots(AckedSequence, RejectedSequences, RoundsRemaining);
+	}
+}
+
+bool APCCharacter::ClientAckShots_Validate(uint16 AckedSequence, const TArray<uint16>& RejectedSequences, int32 RoundsRemaining)
+{
+	return true;
+}
+
+/*
+	ReportHit
+	======================================================================
+	The server never applies character damage from a client's shots
+	itself, the client tells it which characters it hit and when. Hits
+	are gathered for the frame and sent together next tick.
+	======================================================================
+*/
+void APCCharacter::ReportHit(APCCharacter* HitCharacter, const FVector& ShotStart, const FVector& ImpactPoint, uint16 ShotSequence)
+{
+	if (Role == ROLE_Authority || !IsLocallyControlled() || !HitCharacter || PendingReportedHits.Num() >= MaxReportedHitsPerBatch)
+	{
+		return;
+	}
+
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+
+	FPCReportedHit& Hit = PendingReportedHits[PendingReportedHits.AddDefaulted()];
+	Hit.HitCharacter = HitCharacter;
+	Hit.ShotStart = ShotStart;
+	Hit.ImpactPoint = ImpactPoint;
+	Hit.ShotTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	Hit.ShotSequence = ShotSequence;
+
+	if (!GetWorldTimerManager().IsTimerActive(TimerHandle_FlushReportedHits))
+	{
+		TimerHandle_FlushReportedHits = GetWorldTimerManager().SetTimerForNextTick(this, &APCCharacter::FlushReportedHits);
+	}
+}
+
+void APCCharacter::FlushReportedHits()
+{
+	if (PendingReportedHits.Num() > 0)
+	{
+		ServerReportHits(PendingReportedHits);
+		PendingReportedHits.Reset();
+	}
+}
+
+/*
+	ServerReportHits
+	======================================================================
+	Hands the reported hits to the lag compensation manager, rewound by
+	the shooter's one way latency since that is how old the characters
+	it was aiming at were on its screen. Damage comes from our current
+	weapon, never from the client.
+	======================================================================
+*/
+void APCCharacter::ServerReportHits_Implementation(const TArray<FPCReportedHit>& Hits)
+{
+	APCLagCompensationManager* LagCompensation = APCWorldManager::Get<APCLagCompensationManager>(this);
+	if (!LagCompensation || !CurrentWeapon || !bIsWeaponEquipped)
+	{
+		return;
+	}
+
+	for (const FPCReportedHit& Hit : Hits)
+	{
+		// Every accepted shot can hit once
+		if (!Hit.HitCharacter || Hit.HitCharacter == this || !CurrentWeapon->ConsumeAcceptedShot(Hit.ShotSequence))
+		{
+			continue;
+		}
+
+		FPCHitValidationRequest Request;
+		Request.HitCharacter = Hit.HitCharacter;
+		Request.ShotStart = Hit.ShotStart;
+		Request.ShotEnd = Hit.ImpactPoint;
+		// The client's server clock already runs a one-way trip behind ours, only the smoothing delay is left to take off
+		Request.RewindTime = Hit.ShotTime - LagCompensation->ProxyInterpolationDelay;
+		Request.Damage = CurrentWeapon->GetShotDamage();
+		Request.DamageType = CurrentWeapon->GetDamageType();
+		Request.DamageCauser = CurrentWeapon;
+		Request.InstigatorController = GetController();
+		LagCompensation->QueueHitValidation(Request);
+	}
+}
+
+bool APCCharacter::ServerReportHits_Validate(const TArray<FPCReportedHit>& Hits)
+{
+	return Hits.Num() <= MaxReportedHitsPerBatch;
+}
+
+/*
+	TakeDamage
+	======================================================================
+	Point damage is scaled by the limb it landed on before the health
+	component (bound to OnTakeAnyDamage) sees it.
+	======================================================================
+*/
+float APCCharacter::TakeDamage(float Damage, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	if (LimbHealthComp && Role == ROLE_Authority && DamageEvent.IsOfType(FPointDamageEvent::ClassID) && ShouldTakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser))
+	{
+		const FPointDamageEvent& PointDamageEvent = static_cast<const FPointDamageEvent&>(DamageEvent);
+		Damage = LimbHealthComp->ApplyPointDamage(PointDamageEvent.HitInfo, Damage);
+	}
+
+	return Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
+}
+
+void APCCharacter::HandleTakeAnyDamageNetActivity(AActor* DamagedActor, float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser)
+{
+	NotifyNetActivity();
+}
+
+/*
+	ManagedTick
+	======================================================================
+	Server only, ticked at a low rate by the tick manager. Rises to the
+	rate the current state asks for immediately and decays towards it
+	gradually, down to the idle floor.
+	======================================================================
+*/
+void APCCharacter::ManagedTick(float DeltaTime)
+{
+	if (bIsSprinting || bIsAiming)
+	{
+		LastNetActivityTime = GetWorld()->TimeSeconds;
+	}
+
+	float TargetFrequency = IdleNetUpdateFrequency;
+	if (GetWorld()->TimeSeconds - LastNetActivityTime < NetActivityHoldTime)
+	{
+		TargetFrequency = ActiveNetUpdateFrequency;
+	}
+	else if (GetVelocity().SizeSquared() > 1.0f)
+	{
+		TargetFrequency = MovingNetUpdateFrequency;
+	}
+
+	if (TargetFrequency >= NetUpdateFrequency)
+	{
+		SetAdaptiveNetUpdateFrequency(TargetFrequency);
+	}
+	else
+	{
+		const float DecayRate = (ActiveNetUpdateFrequency - IdleNetUpdateFrequency) / FMath::Max(NetUpdateDecayTime, KINDA_SMALL_NUMBER);
+		SetAdaptiveNetUpdateFrequency(FMath::Max(TargetFrequency, NetUpdateFrequency - DecayRate * DeltaTime));
+	}
+}
+
+/*
+	GetNetPriority
+	======================================================================
+	Per connection priority for the legacy net driver, the replication
+	graph uses GetNetViewScale directly to space out updates instead.
+	======================================================================
+*/
+float APCCharacter::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	// Our own pawn, keep the pawn's view target boost
+	if (ViewTarget == this || (Viewer && Viewer == Controller))
+	{
+		return Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth);
+	}
+
+	return NetPriority * Time * GetNetViewScale(ViewPos, ViewDir, bLowBandwidth);
+}
+
+/*
+	GetNetViewScale
+	======================================================================
+	Characters close to the viewer and in front of them go first, far
+	away ones and ones behind the viewer wait. Recently active characters
+	get a boost. Low bandwidth viewers only get the full rate for what
+	they are looking at.
+	======================================================================
+*/
+float APCCharacter::GetNetViewScale(const FVector& ViewPos, const FVector& ViewDir, bool bLowBandwidth) const
+{
+	const FVector ToCharacter = GetActorLocation() - ViewPos;
+	const float Distance = ToCharacter.Size();
+
+	float Scale = 1.0f;
+
+	// Fall off past the full distance down to a quarter at the cull distance
+	const float CullDistance = FMath::Sqrt(NetCullDistanceSquared);
+	if (Distance > NetPriorityFullDistance && CullDistance > NetPriorityFullDistance)
+	{
+		const float Alpha = FMath::Clamp((Distance - NetPriorityFullDistance) / (CullDistance - NetPriorityFullDistance), 0.0f, 1.0f);
+		Scale *= FMath::Lerp(1.0f, 0.25f, Alpha);
+	}
+
+	// In the viewer's rough field of view counts double, behind them half
+	const float ViewDot = ViewDir | (Distance > KINDA_SMALL_NUMBER ? ToCharacter / Distance : FVector::ZeroVector);
+	if (ViewDot > 0.7f)
+	{
+		Scale *= 2.0f;
+	}
+	else if (ViewDot < 0.0f)
+	{
+		Scale *= 0.5f;
+	}
+
+	if (GetWorld()->TimeSeconds - LastNetActivityTime < NetActivityHoldTime)
+	{
+		Scale *= 1.5f;
+	}
+
+	if (bLowBandwidth)
+	{
+		Scale *= 0.5f;
+	}
+
+	return Scale;
 }
 
 /*
@@ -142,6 +859,9 @@ void APCCharacter::StartSprint()
 
 	GetCharacterMovement()->MaxWalkSpeed = MaxSprintSpeed;
 	bIsSprinting = true;
+
+	NotifyNetActivity();
+	UpdateNetState();
 }
 
 /*
@@ -154,6 +874,8 @@ void APCCharacter::StopSprint()
 {
 	GetCharacterMovement()->MaxWalkSpeed = BaseWalkSpeed;
 	bIsSprinting = false;
+
+	UpdateNetState();
 }
 
 /*
@@ -189,6 +911,9 @@ void APCCharacter::ToggleCrouch()
 void APCCharacter::LeanLeft()
 {
 	bIsLeaningLeft = !bIsLeaningLeft;
+
+	StartLeanTransition(GetLeanAmount());
+	UpdateNetState();
 }
 
 /*
@@ -201,6 +926,9 @@ void APCCharacter::LeanLeft()
 void APCCharacter::LeanRight()
 {
 	bIsLeaningRight = !bIsLeaningRight;
+
+	StartLeanTransition(GetLeanAmount());
+	UpdateNetState();
 }
 
 /*
@@ -239,6 +967,9 @@ float APCCharacter::GetLeanAmount()
 void APCCharacter::Peak()
 {
 	bIsPeaking = !bIsPeaking;
+
+	StartPeakTransition(GetPeakAmount());
+	UpdateNetState();
 }
 
 /*
@@ -259,101 +990,187 @@ float APCCharacter::GetPeakAmount()
 	}
 }
 
+/*
+	StartLeanTransition
+	======================================================================
+	Blend LeanAmount from its current value to TargetLean.
+	======================================================================
+*/
+void APCCharacter::StartLeanTransition(float TargetLean)
+{
+	const float From = LeanAmount;
+	const float To = TargetLean;
+
+	TransitionComp->StartTransition(TransitionName_Lean, LeanTime, LeanCurve, [this, From, To](float Alpha)
+	{
+		LeanAmount = FMath::Lerp(From, To, Alpha);
+	});
+}
+
+/*
+	StartPeakTransition
+	======================================================================
+	Blend PeakAmount from its current value to TargetPeak.
+	======================================================================
+*/
+void APCCharacter::StartPeakTransition(float TargetPeak)
+{
+	const float From = PeakAmount;
+	const float To = TargetPeak;
+
+	TransitionComp->StartTransition(TransitionName_Peak, LeanTime, LeanCurve, [this, From, To](float Alpha)
+	{
+		PeakAmount = FMath::Lerp(From, To, Alpha);
+	});
+}
+
 /*
 	Interact
 	======================================================================
-	Attempt to interact with an interactable object. Sends a raycast out
-	from the head, if it hits anything with the IInteractable interface
-	it will call its OnInteract function.
+	Attempt to interact with an interactable object. Picks the focused
+	interactable from the interactable registry and calls its OnInteract
+	function. With bConfirmInteractTrace a single trace makes sure
+	nothing is in the way first.
 	======================================================================
 */
 void APCCharacter::Interact()
 {
-	FHitResult OutHit;
-	FVector Start = GetMesh()->GetSocketLocation("head");
-	FVector ForwardVector = GetMesh()->GetForwardVector();
-	FVector End = ((ForwardVector * InteractDistance) + Start);
-	FCollisionQueryParams CollisionParams;
+	UpdateInteractFocus();
 
-	// Draw a debug line to show the raycast
-	DrawDebugLine(GetWorld(), Start, End, FColor::Red, true);
-
-	bool IsHit = GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, CollisionParams);
+	AActor* Target = FocusedInteractable.Get();
+	if (!Target)
+	{
+		return;
+	}
 
-	if (IsHit)
+	if (bConfirmInteractTrace)
 	{
-		if (OutHit.bBlockingHit)
+		FVector Start;
+		FVector Direction;
+		GetInteractView(Start, Direction);
+
+		FCollisionQueryParams CollisionParams(SCENE_QUERY_STAT(InteractConfirm), false, this);
+		FHitResult OutHit;
+		if (GetWorld()->LineTraceSingleByChannel(OutHit, Start, Target->GetActorLocation(), ECC_Visibility, CollisionParams) && OutHit.GetActor() != Target)
 		{
-			IInteractable* InteractableActor = Cast<IInteractable>(OutHit.Actor);
-			if (InteractableActor)
+			if (DebugInteractDrawing > 0)
 			{
-				InteractableActor->Execute_OnInteract(Cast<UObject>(InteractableActor));
+				DrawDebugLine(GetWorld(), Start, OutHit.ImpactPoint, FColor::Red, false, 2.0f);
 			}
+			return;
 		}
 	}
+
+	IInteractable::Execute_OnInteract(Target);
+}
+
+void APCCharacter::GetInteractView(FVector& OutLocation, FVector& OutDirection) const
+{
+	OutLocation = GetMesh()->GetSocketLocation("head");
+	OutDirection = GetMesh()->GetForwardVector();
 }
 
 /*
-	ToggleEquipWeapon
+	UpdateInteractFocus
 	======================================================================
-	Toggles equipping and unequipping the current weapon (gun).
-	This function delegates execution for networking.
-	The LocalToggleEquipWeapon function below contains the actual
-	equip logic.
+	Cone query against the interactable registry, cheap enough to run on
+	a timer for prompts. Listeners only hear about it when the focused
+	interactable actually changes.
 	======================================================================
 */
-void APCCharacter::ToggleEquipWeapon()
+void APCCharacter::UpdateInteractFocus()
 {
-	if (bWasJumping || bIsAiming)
-	{
-		return;
-	}
+	AActor* NewFocus = nullptr;
 
-	if (Role != ROLE_Authority)
+	APCInteractableRegistry* Registry = APCWorldManager::Get<APCInteractableRegistry>(this);
+	if (Registry && !bIsDead)
 	{
-		LocalToggleEquipWeapon();
-		ServerToggleEquipWeapon();
+		FVector Start;
+		FVector Direction;
+		GetInteractView(Start, Direction);
+
+		NewFocus = Registry->FindInteractableInCone(Start, Direction, InteractDistance, InteractConeAngle, this);
+
+		if (DebugInteractDrawing > 0)
+		{
+			DrawDebugCone(GetWorld(), Start, Direction, InteractDistance, FMath::DegreesToRadians(InteractConeAngle), FMath::DegreesToRadians(InteractConeAngle), 8, FColor::Yellow, false, 0.5f);
+			if (NewFocus)
+			{
+				DrawDebugLine(GetWorld(), Start, NewFocus->GetActorLocation(), FColor::Green, false, 0.5f);
+			}
+		}
 	}
-	else if (Role == ROLE_Authority)
+
+	// A focused actor that got destroyed still needs its prompt cleared
+	if (NewFocus != FocusedInteractable.Get() || FocusedInteractable.IsStale())
 	{
-		LocalToggleEquipWeapon();
-		MulticastToggleEquipWeapon();
+		FocusedInteractable = NewFocus;
+		OnInteractFocusChanged.Broadcast(this, NewFocus);
 	}
 }
 
-void APCCharacter::ServerToggleEquipWeapon_Implementation()
+AActor* APCCharacter::GetFocusedInteractable() const
 {
-	MulticastToggleEquipWeapon();
+	return FocusedInteractable.Get();
 }
 
-void APCCharacter::MulticastToggleEquipWeapon_Implementation()
+/*
+	ToggleEquipWeapon
+	======================================================================
+	Toggles equipping and unequipping the current weapon (gun).
+	Equips locally straight away and tells the server the state we
+	want. The server passes it on to everyone else in the net state.
+	======================================================================
+*/
+void APCCharacter::ToggleEquipWeapon()
 {
-	if (!IsLocallyControlled())
+	if (bWasJumping || bIsAiming)
 	{
-		LocalToggleEquipWeapon();
+		return;
+	}
+
+	const bool bEquip = !bIsWeaponEquipped;
+
+	SetWeaponEquipped(bEquip);
+
+	if (Role != ROLE_Authority)
+	{
+		ServerSetWeaponEquipped(bEquip);
 	}
 }
 
-bool APCCharacter::ServerToggleEquipWeapon_Validate()
+void APCCharacter::ServerSetWeaponEquipped_Implementation(bool bEquip)
 {
-	return true;
+	SetWeaponEquipped(bEquip);
 }
 
-bool APCCharacter::MulticastToggleEquipWeapon_Validate()
+bool APCCharacter::ServerSetWeaponEquipped_Validate(bool bEquip)
 {
 	return true;
 }
 
-void APCCharacter::LocalToggleEquipWeapon()
+void APCCharacter::SetWeaponEquipped(bool bEquip)
 {
-	if (bIsWeaponEquipped)
+	if (bEquip == bIsWeaponEquipped)
 	{
-		UnequipWeapon();
+		return;
 	}
-	else
+
+	if (bEquip)
 	{
 		EquipWeapon(PrimaryWeapon);
 	}
+	else
+	{
+		UnequipWeapon();
+	}
+
+	// Replicated as state so late joiners and receivers that fell behind still get it right
+	if (Role == ROLE_Authority)
+	{
+		NetState.bIsWeaponEquipped = bEquip;
+		NotifyNetActivity();
+	}
 }
 
 void APCCharacter::EquipWeapon(APCWeaponBase* Weapon)
@@ -433,7 +1250,31 @@ void APCCharacter::PutCurrentWeaponInHolster()
 void APCCharacter::BeginReload()
 {
 	bCanFire = false;
-	
+
+	PlayReloadAnimation();
+
+	if (Role == ROLE_Authority)
+	{
+		PushCharacterEvent(EPCCharacterEvent::RELOAD);
+	}
+	else if (IsLocallyControlled())
+	{
+		ServerBeginReload();
+	}
+}
+
+void APCCharacter::ServerBeginReload_Implementation()
+{
+	BeginReload();
+}
+
+bool APCCharacter::ServerBeginReload_Validate()
+{
+	return true;
+}
+
+void APCCharacter::PlayReloadAnimation()
+{
 	if (CurrentWeapon)
 	{
 		// Play the reload animation
@@ -446,27 +1287,35 @@ void APCCharacter::BeginReload()
 
 void APCCharacter::TakeMagazineInHands()
 {
-	if (CurrentWeapon && CurrentWeapon->GetCurrentMagazine())
+	if (CurrentWeapon && CurrentWeapon->GetMagazine().IsValid())
 	{
-		CurrentWeapon->GetCurrentMagazine()->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, MagazineHandSocketName);
-		CurrentWeapon->GetCurrentMagazine()->DoHandOffset();
+		CurrentWeapon->AttachMagazineToHand(GetMesh(), MagazineHandSocketName);
 		CurrentWeapon->PlayMagEjectSound();
 	}
 }
 
 void APCCharacter::PutMagazineInWeapon()
 {
-	if (CurrentWeapon && CurrentWeapon->GetCurrentMagazine())
+	if (CurrentWeapon && CurrentWeapon->GetMagazine().IsValid())
 	{
-		CurrentWeapon->GetCurrentMagazine()->AttachToComponent(CurrentWeaponMesh, FAttachmentTransformRules::SnapToTargetNotIncludingScale, CurrentWeapon->GetMagazineSocketName());
-		CurrentWeapon->GetCurrentMagazine()->DoGunOffset();
+		CurrentWeapon->AttachMagazineToWeapon();
 		CurrentWeapon->PlayMagInsertSound();
 	}
 }
 
 void APCCharacter::FinishReload()
 {
-	CurrentWeapon->Reload();
+	// Simulated proxies don't get the inventory, they only need to show a full magazine
+	if (InventoryComp && (Role == ROLE_Authority || IsLocallyControlled()))
+	{
+		FPCMagazineState Magazine = CurrentWeapon->GetMagazine();
+		InventoryComp->ReloadMagazine(CurrentWeapon->GetMagazineClass(), Magazine);
+		CurrentWeapon->LoadMagazine(Magazine);
+	}
+	else
+	{
+		CurrentWeapon->Reload();
+	}
 	bCanFire = true;
 }
 
@@ -486,15 +1335,17 @@ void APCCharacter::StartAim()
 	bIsAiming = true;
 	bDoingSmoothAim = true;
 	bDoingSmoothStopAimWeapon = false;
+
+	NotifyNetActivity();
 	
 	GetCharacterMovement()->SetJumpAllowed(false);
 	GetCharacterMovement()->MaxWalkSpeed = AimWalkSpeed;
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_ADS);
-	GetWorldTimerManager().SetTimer(TimerHandle_ADS, this, &APCCharacter::PostSmoothAim, 0.8f, false);
+	StartWeaponAimTransition(true);
+	UpdateNetState();
 }
 
-// Called with some delay after the smooth aim has started
+// Called when the smooth aim has finished
 void APCCharacter::PostSmoothAim()
 {
 	bDoingSmoothAim = false;
@@ -515,16 +1366,62 @@ void APCCharacter::StopAim()
 	GetCharacterMovement()->SetJumpAllowed(true);
 	GetCharacterMovement()->MaxWalkSpeed = BaseWalkSpeed;
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_StopADS);
-	GetWorldTimerManager().SetTimer(TimerHandle_StopADS, this, &APCCharacter::PostStopSmoothAim, 0.8f, false);
+	StartWeaponAimTransition(false);
+	UpdateNetState();
 }
 
-// Called with some delay after smooth "un-aim"
+// Called when the smooth "un-aim" has finished
 void APCCharacter::PostStopSmoothAim()
 {
 	bDoingSmoothStopAimWeapon = false;
 }
 
+/*
+	StartWeaponAimTransition
+	======================================================================
+	Blend the current weapon between its hip and aim transforms. Without
+	cosmetics the weapon snaps instead, so the muzzle used for server
+	side shots is still in the right place.
+	======================================================================
+*/
+void APCCharacter::StartWeaponAimTransition(bool bAim)
+{
+	if (!bIsWeaponEquipped || !CurrentWeapon || !CurrentWeaponMesh)
+	{
+		TransitionComp->StopTransition(TransitionName_WeaponAim, false);
+		bDoingSmoothAim = false;
+		bDoingSmoothStopAimWeapon = false;
+		return;
+	}
+
+	const FVector FromLocation = CurrentWeaponMesh->RelativeLocation;
+	const FQuat FromRotation = CurrentWeaponMesh->RelativeRotation.Quaternion();
+	const FVector ToLocation = bAim ? CurrentWeapon->GetAimLocation() : CurrentWeapon->GetHipLocation();
+	const FQuat ToRotation = (bAim ? CurrentWeapon->GetAimRotation() : CurrentWeapon->GetHipRotation()).Quaternion();
+	const float Duration = PCShouldPlayCosmetics(this) ? (bAim ? AimInTime : AimOutTime) : 0.0f;
+
+	TWeakObjectPtr<USkeletalMeshComponent> WeaponMesh = CurrentWeaponMesh;
+
+	TransitionComp->StartTransition(TransitionName_WeaponAim, Duration, AimCurve, [WeaponMesh, FromLocation, FromRotation, ToLocation, ToRotation](float Alpha)
+	{
+		if (WeaponMesh.IsValid())
+		{
+			WeaponMesh->SetRelativeLocationAndRotation(FMath::Lerp(FromLocation, ToLocation, Alpha), FQuat::Slerp(FromRotation, ToRotation, Alpha));
+		}
+	},
+	[this, bAim]()
+	{
+		if (bAim)
+		{
+			PostSmoothAim();
+		}
+		else
+		{
+			PostStopSmoothAim();
+		}
+	});
+}
+
 /*
 	ChangeFiremode
 	======================================================================
@@ -559,6 +1456,8 @@ void APCCharacter::StartFire()
 	{
 		CurrentWeapon->StartFire(); // Call the fire function on the weapon
 	}
+
+	NotifyNetActivity();
 }
 
 /*
@@ -635,7 +1534,7 @@ void APCCharacter::StopMeleeAttack() {
 void APCCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(APCCharacter, bIsSprinting, COND_SkipOwner);
-	DOREPLIFETIME_CONDITION(APCCharacter, bIsAiming, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(APCCharacter, NetState, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(APCCharacter, EventStream, COND_SkipOwner);
 }
 
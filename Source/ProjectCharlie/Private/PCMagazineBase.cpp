@@ -1,106 +1,63 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PCMagazineBase.h"
-#include "DrawDebugHelpers.h"
-#include "Kismet/GameplayStatics.h"
-#include "Components/StaticMeshComponent.h"
-#include "PCProjectileBase.h"
+#include "Engine/StaticMesh.h"
 
-// Sets default values
-APCMagazineBase::APCMagazineBase()
+FPCMagazineState::FPCMagazineState(TSubclassOf<APCMagazineBase> InMagazineClass)
+	: MagazineClass(InMagazineClass)
+	, MaxCapacity(0)
+	, RoundsRemaining(0)
 {
-	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
-
-	// Create a Mesh Component for the magazine
-	MeshComp = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MeshComp"));
-
-	if (FullMesh)
+	if (const APCMagazineBase* Defaults = GetDefaults())
 	{
-		MeshComp->SetStaticMesh(FullMesh);
+		ProjectileClass = Defaults->ProjectileClass;
+		MaxCapacity = Defaults->MaxCapacity;
+		RoundsRemaining = FMath::Clamp(Defaults->RoundsRemaining, 0, MaxCapacity);
 	}
-
-	// Make Root the Mesh Component
-	RootComponent = MeshComp;
 }
 
-void APCMagazineBase::BeginPlay()
+const APCMagazineBase* FPCMagazineState::GetDefaults() const
 {
-	Super::BeginPlay();
+	return MagazineClass ? MagazineClass->GetDefaultObject<APCMagazineBase>() : nullptr;
 }
 
-UStaticMeshComponent* APCMagazineBase::GetMagazineMeshComp()
+// Sets default values
+APCMagazineBase::APCMagazineBase()
 {
-	return MeshComp;
-}
+	PrimaryActorTick.bCanEverTick = false;
 
-void APCMagazineBase::ShowEmptyMesh()
-{
-	if (EmptyMesh)
-	{
-		MeshComp->SetStaticMesh(EmptyMesh);
-	}
+	EmptyMesh = nullptr;
+	FullMesh = nullptr;
+	MaxCapacity = 0;
+	RoundsRemaining = 0;
 }
 
-void APCMagazineBase::ShowFullMesh()
+UStaticMesh* APCMagazineBase::GetMesh(bool bEmpty) const
 {
-	if (FullMesh)
+	if (bEmpty)
 	{
-		MeshComp->SetStaticMesh(FullMesh);
+		return EmptyMesh ? EmptyMesh : FullMesh;
 	}
+
+	return FullMesh ? FullMesh : EmptyMesh;
 }
 
-FVector APCMagazineBase::GetGunSocketOffsetLocation()
+FVector APCMagazineBase::GetGunSocketOffsetLocation() const
 {
 	return GunSocketOffsetLocation;
 }
 
-FVector APCMagazineBase::GetHandSocketOffsetLocation()
+FVector APCMagazineBase::GetHandSocketOffsetLocation() const
 {
 	return HandSocketOffsetLocation;
 }
 
-FRotator APCMagazineBase::GetGunSocketOffsetRotation()
+FRotator APCMagazineBase::GetGunSocketOffsetRotation() const
 {
 	return GunSocketOffsetRotation;
 }
 
-FRotator APCMagazineBase::GetHandSocketOffsetRotation()
+FRotator APCMagazineBase::GetHandSocketOffsetRotation() const
 {
 	return HandSocketOffsetRotation;
 }
-
-void APCMagazineBase::DoGunOffset()
-{
-	RootComponent->SetRelativeLocationAndRotation(GunSocketOffsetLocation, GunSocketOffsetRotation);
-}
-
-void APCMagazineBase::DoHandOffset()
-{
-	RootComponent->SetRelativeLocationAndRotation(HandSocketOffsetLocation, HandSocketOffsetRotation);
-}
-
-void APCMagazineBase::Empty()
-{
-	RoundsRemaining = 0;
-}
-
-void APCMagazineBase::Refill()
-{
-	RoundsRemaining = MaxCapacity;
-}
-
-void APCMagazineBase::UnloadOneRound()
-{
-	RoundsRemaining = RoundsRemaining - 1;
-}
-
-void APCMagazineBase::LoadOneRound()
-{
-	RoundsRemaining = RoundsRemaining + 1;
-}
-
-bool APCMagazineBase::IsEmpty()
-{
-	return RoundsRemaining <= 0;
-}
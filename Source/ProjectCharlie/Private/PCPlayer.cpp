@@ -1,6 +1,7 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PCPlayer.h"
+#include "ProjectCharlie.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -17,6 +18,12 @@
 #include "TimerManager.h"
 #include "Animation/AnimInstance.h"
 #include "PCWeaponBase.h"
+#include "Components/PCTransitionComponent.h"
+
+namespace
+{
+	const FName TransitionName_Camera = TEXT("Camera");
+}
 
 //////////////////////////////////////////////////////////////////////////
 // AProjectCharlieCharacter
@@ -27,9 +34,12 @@ APCPlayer::APCPlayer()
 		Initialize Values/Flags/etc.
 		----------------------------------------------------------------
 	*/
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 	NetUpdateFrequency = 66.0f;
-	MinNetUpdateFrequency = 33.0f;
+	MinNetUpdateFrequency = 10.0f;
+	ActiveNetUpdateFrequency = 66.0f;
+	MovingNetUpdateFrequency = 33.0f;
+	IdleNetUpdateFrequency = 10.0f;
 
 	BaseTurnRate = 1.0f;
 	BaseLookUpRate = 1.0f;
@@ -51,6 +61,8 @@ APCPlayer::APCPlayer()
 	FollowCameraAimRotation = FRotator(0.0f, 0.0f, -4.554169f);
 	CameraBoomDefaultLength = 300.0f;
 	CameraBoomAimLength = 150.0f;
+	ThirdPersonAimTime = 0.75f;
+	InteractFocusInterval = 0.1f;
 
 	/*
 		Initialize Components
@@ -92,41 +104,6 @@ void APCPlayer::BeginPlay()
 	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
 }
 
-/*
-	Tick
-	======================================================================
-	Called every game tick.
-	Currently used for smooth transitions, etc.
-	======================================================================
-*/
-void APCPlayer::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-	// Smooth ADS Camera Position
-	if (bIsFirstPerson && bIsWeaponEquipped && bIsAiming && bDoingSmoothAim)
-	{
-		FPCamera->SetRelativeLocation(FMath::VInterpTo(FPCamera->RelativeLocation, CurrentWeapon->GetADSOffset(), DeltaTime, CurrentWeapon->GetAimSpeed()));
-	}
-	else if (bIsFirstPerson && bIsWeaponEquipped && !bIsAiming && bDoingSmoothStopAimCamera)
-	{
-		FPCamera->SetRelativeLocation(FMath::VInterpTo(FPCamera->RelativeLocation, FPCameraDefaultLocation, DeltaTime, CurrentWeapon->GetAimSpeed()));
-	}
-
-	if (!bIsFirstPerson && bIsWeaponEquipped && bIsAiming)
-	{
-		FollowCamera->SetRelativeLocation(FMath::VInterpTo(FollowCamera->RelativeLocation, FollowCameraAimLocation, DeltaTime, 4.0f));
-		FollowCamera->SetRelativeRotation(FMath::RInterpTo(FollowCamera->RelativeRotation, FollowCameraAimRotation, DeltaTime, 4.0f));
-		CameraBoom->TargetArmLength = FMath::FInterpTo(CameraBoom->TargetArmLength, CameraBoomAimLength, DeltaTime, 4.0f);
-	}
-	else if (!bIsFirstPerson && bIsWeaponEquipped && !bIsAiming)
-	{
-		FollowCamera->SetRelativeLocation(FMath::VInterpTo(FollowCamera->RelativeLocation, FollowCameraDefaultLocation, DeltaTime, 4.0f));
-		FollowCamera->SetRelativeRotation(FMath::RInterpTo(FollowCamera->RelativeRotation, FollowCameraDefaultRotation, DeltaTime, 4.0f));
-		CameraBoom->TargetArmLength = FMath::FInterpTo(CameraBoom->TargetArmLength, CameraBoomDefaultLength, DeltaTime, 4.0f);
-	}
-}
-
 /*
 	SetupPlayerInputComponent
 	======================================================================
@@ -190,6 +167,9 @@ void APCPlayer::SetupPlayerInputComponent(class UInputComponent* PlayerInputComp
 
 	// Test for networking, leave for now
 	PlayerInputComponent->BindAction("Test", IE_Pressed, this, &APCPlayer::TestFire);
+
+	// Only the locally controlled player needs to know what it is looking at
+	GetWorldTimerManager().SetTimer(TimerHandle_InteractFocus, this, &APCPlayer::UpdateInteractFocus, InteractFocusInterval, true);
 }
 
 void APCPlayer::OnResetVR()
@@ -297,11 +277,28 @@ void APCPlayer::ToggleView()
 				}
 
 				CamManager->StartCameraFade(1.0f, 0.0f, 0.1f, FColor::Black);
+
+				UpdateNetState();
 			}
 		}
 	}
 }
 
+FPCCharacterNetState APCPlayer::BuildNetState()
+{
+	FPCCharacterNetState State = Super::BuildNetState();
+	State.bIsFirstPerson = bIsFirstPerson;
+	return State;
+}
+
+// Remote copies only need the flag (for animation), the cameras are local
+void APCPlayer::ApplyNetState(const FPCCharacterNetState& NewState, const FPCCharacterNetState& OldState)
+{
+	Super::ApplyNetState(NewState, OldState);
+
+	bIsFirstPerson = NewState.bIsFirstPerson;
+}
+
 /*
 	SetFirstPerson
 	======================================================================
@@ -333,6 +330,12 @@ void APCPlayer::SetThirdPerson()
 	GetCharacterMovement()->bUseControllerDesiredRotation = false;
 	GetCharacterMovement()->bOrientRotationToMovement = true;
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 500.0f, 0.0f);
+
+	// Pull the boom back in if we switched over while aiming
+	if (bIsWeaponEquipped && bIsAiming)
+	{
+		StartThirdPersonCameraTransition(true);
+	}
 }
 
 /*
@@ -358,6 +361,18 @@ void APCPlayer::StartAim()
 
 	FName RearSightName = "RearSight";
 	FPCamera->AttachTo(CurrentWeaponMesh, RearSightName, EAttachLocation::KeepWorldPosition);
+
+	if (bIsAiming)
+	{
+		if (bIsFirstPerson)
+		{
+			StartFirstPersonCameraTransition(true);
+		}
+		else
+		{
+			StartThirdPersonCameraTransition(true);
+		}
+	}
 }
 
 void APCPlayer::PostSmoothAim()
@@ -390,49 +405,99 @@ void APCPlayer::StopAim()
 
 		FName HeadSocketName = "head";
 		FPCamera->AttachTo(GetMesh(), HeadSocketName, EAttachLocation::KeepWorldPosition);
+
+		if (bIsFirstPerson)
+		{
+			StartFirstPersonCameraTransition(false);
+		}
+		else
+		{
+			StartThirdPersonCameraTransition(false);
+		}
 	}
 }
 
-// Called with some delay after smooth "un-aim"
+// Called when the weapon has finished its smooth "un-aim"
 void APCPlayer::PostStopSmoothAim()
 {
 	Super::PostStopSmoothAim();
-
-	bDoingSmoothStopAimCamera = false;
 }
 
 /*
-	Interact
+	StartFirstPersonCameraTransition
 	======================================================================
-	Attempt to interact with an interactable object. Sends a raycast out
-	from the head, if it hits anything with the IInteractable interface
-	it will call its OnInteract function.
+	Blend the first person camera to the sights or back to the head.
+	Uses the weapon's aim speed so each gun keeps its own ADS feel.
 	======================================================================
 */
-void APCPlayer::Interact()
+void APCPlayer::StartFirstPersonCameraTransition(bool bAim)
 {
-	FHitResult OutHit;
-	FVector Start = FPCamera->GetComponentLocation();
-	FVector ForwardVector = FPCamera->GetForwardVector();
-	FVector End = ((ForwardVector * InteractDistance) + Start);
-	FCollisionQueryParams CollisionParams;
+	if (!bIsWeaponEquipped || !CurrentWeapon || !PCShouldPlayCosmetics(this))
+	{
+		bDoingSmoothStopAimCamera = false;
+		return;
+	}
 
-	// Draw a debug line to show the raycast
-	//DrawDebugLine(GetWorld(), Start, End, FColor::Red, true);
+	const FVector From = FPCamera->RelativeLocation;
+	const FVector To = bAim ? CurrentWeapon->GetADSOffset() : FPCameraDefaultLocation;
 
-	bool IsHit = GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, CollisionParams);
+	// The old per-frame interpolation got ~95% of the way in 3 / speed seconds
+	const float Duration = 3.0f / FMath::Max(CurrentWeapon->GetAimSpeed(), KINDA_SMALL_NUMBER);
 
-	if (IsHit)
+	TransitionComp->StartTransition(TransitionName_Camera, Duration, AimCurve, [this, From, To](float Alpha)
 	{
-		if (OutHit.bBlockingHit)
-		{
-			IInteractable* InteractableActor = Cast<IInteractable>(OutHit.Actor);
-			if (InteractableActor)
-			{
-				InteractableActor->Execute_OnInteract(Cast<UObject>(InteractableActor));
-			}
-		}
+		FPCamera->SetRelativeLocation(FMath::Lerp(From, To, Alpha));
+	},
+	[this]()
+	{
+		bDoingSmoothStopAimCamera = false;
+	});
+}
+
+/*
+	StartThirdPersonCameraTransition
+	======================================================================
+	Blend the follow camera and boom length to the over the shoulder
+	aim position or back to the default.
+	======================================================================
+*/
+void APCPlayer::StartThirdPersonCameraTransition(bool bAim)
+{
+	if (!bIsWeaponEquipped || !PCShouldPlayCosmetics(this))
+	{
+		bDoingSmoothStopAimCamera = false;
+		return;
 	}
+
+	const FVector FromLocation = FollowCamera->RelativeLocation;
+	const FQuat FromRotation = FollowCamera->RelativeRotation.Quaternion();
+	const float FromLength = CameraBoom->TargetArmLength;
+	const FVector ToLocation = bAim ? FollowCameraAimLocation : FollowCameraDefaultLocation;
+	const FQuat ToRotation = (bAim ? FollowCameraAimRotation : FollowCameraDefaultRotation).Quaternion();
+	const float ToLength = bAim ? CameraBoomAimLength : CameraBoomDefaultLength;
+
+	TransitionComp->StartTransition(TransitionName_Camera, ThirdPersonAimTime, AimCurve, [this, FromLocation, FromRotation, FromLength, ToLocation, ToRotation, ToLength](float Alpha)
+	{
+		FollowCamera->SetRelativeLocationAndRotation(FMath::Lerp(FromLocation, ToLocation, Alpha), FQuat::Slerp(FromRotation, ToRotation, Alpha));
+		CameraBoom->TargetArmLength = FMath::Lerp(FromLength, ToLength, Alpha);
+	},
+	[this]()
+	{
+		bDoingSmoothStopAimCamera = false;
+	});
+}
+
+/*
+	GetInteractView
+	======================================================================
+	Players interact with whatever is in the middle of the first person
+	camera.
+	======================================================================
+*/
+void APCPlayer::GetInteractView(FVector& OutLocation, FVector& OutDirection) const
+{
+	OutLocation = FPCamera->GetComponentLocation();
+	OutDirection = FPCamera->GetForwardVector();
 }
 
 
@@ -515,11 +580,4 @@ void APCPlayer::StopTestFire(AActor* Effect)
 }
 
 // End Networking Test Example
-// ==============================================
-
-void APCPlayer::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
-{
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-
-	DOREPLIFETIME_CONDITION(APCPlayer, bIsFirstPerson, COND_SkipOwner);
-}
\ No newline at end of file
+// ==============================================
\ No newline at end of file
@@ -1,13 +1,24 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PCProjectileBase.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Systems/PCProjectilePool.h"
 
 // Sets default values
 APCProjectileBase::APCProjectileBase()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Projectiles don't tick, movement is handled by projectile movement or the ballistics manager
+	PrimaryActorTick.bCanEverTick = false;
 
+	bIsInPool = false;
+
+	bUseBallistics = false;
+	bSpawnRepresentation = true;
+	MuzzleVelocity = 37000.0f;
+	DragCoefficient = 0.00001f;
+	GravityScale = 1.0f;
+	MaxLifetime = 3.0f;
+	BaseDamage = 20.0f;
 }
 
 // Called when the game starts or when spawned
@@ -17,11 +28,15 @@ void APCProjectileBase::BeginPlay()
 	
 }
 
-// Called every frame
-void APCProjectileBase::Tick(float DeltaTime)
+void APCProjectileBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	// Destroyed while handed out (DestroyActor on hit, kill Z, level teardown), the pool still counts us as in use
+	if (!bIsInPool && OwningPool.IsValid())
+	{
+		OwningPool->NotifyProjectileLost(this);
+	}
 
+	Super::EndPlay(EndPlayReason);
 }
 
 void APCProjectileBase::SetOrigin(FVector Location)
@@ -34,5 +49,92 @@ FVector APCProjectileBase::GetOrigin()
 	return Origin;
 }
 
+void APCProjectileBase::SetPool(APCProjectilePool* InPool)
+{
+	OwningPool = InPool;
+}
 
+bool APCProjectileBase::IsInPool() const
+{
+	return bIsInPool;
+}
+
+void APCProjectileBase::OnAcquiredFromPool(const FVector& Location, const FRotator& Rotation)
+{
+	bIsInPool = false;
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	SetActorHiddenInGame(false);
+
+	// Simulated rounds are moved by the ballistics manager, so the actor stays a passive visual
+	if (bUseBallistics)
+	{
+		ReceiveAcquiredFromPool();
+		return;
+	}
+
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(PrimaryActorTick.bStartWithTickEnabled);
+	SetLifeSpan(InitialLifeSpan);
+
+	// Relaunch any projectile movement along the new facing
+	TInlineComponentArray<UProjectileMovementComponent*> MovementComps(this);
+	for (UProjectileMovementComponent* MovementComp : MovementComps)
+	{
+		MovementComp->SetUpdatedComponent(GetRootComponent());
+		MovementComp->Velocity = Rotation.Vector() * MovementComp->InitialSpeed;
+		MovementComp->Activate(true);
+		MovementComp->UpdateComponentVelocity();
+	}
+
+	ReceiveAcquiredFromPool();
+}
 
+void APCProjectileBase::OnReleasedToPool()
+{
+	bIsInPool = true;
+
+	SetLifeSpan(0.0f);
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	TInlineComponentArray<UProjectileMovementComponent*> MovementComps(this);
+	for (UProjectileMovementComponent* MovementComp : MovementComps)
+	{
+		MovementComp->StopMovementImmediately();
+		MovementComp->Deactivate();
+	}
+
+	ReceiveReleasedToPool();
+}
+
+void APCProjectileBase::ReturnToPool()
+{
+	if (bIsInPool)
+	{
+		return;
+	}
+
+	if (OwningPool.IsValid())
+	{
+		OwningPool->ReleaseProjectile(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+void APCProjectileBase::LifeSpanExpired()
+{
+	// Pooled projectiles are parked instead of destroyed when their life span runs out
+	if (OwningPool.IsValid())
+	{
+		ReturnToPool();
+	}
+	else
+	{
+		Super::LifeSpanExpired();
+	}
+}
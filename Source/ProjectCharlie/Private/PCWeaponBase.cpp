@@ -1,15 +1,25 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PCWeaponBase.h"
+#include "ProjectCharlie.h"
 #include "DrawDebugHelpers.h"
 #include "Kismet/GameplayStatics.h"
 #include "Particles/ParticleSystem.h"
+#include "Animation/AnimSequence.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "TimerManager.h"
 #include "Sound/SoundCue.h"
-#include "Components/AudioComponent.h"
 #include "PCProjectileBase.h"
+#include "PCWeaponDefinition.h"
+#include "Systems/PCProjectilePool.h"
+#include "Systems/PCBallisticsManager.h"
+#include "Systems/PCWeaponAudioPool.h"
+#include "Systems/PCEffectsPool.h"
+#include "Systems/PCLagCompensationManager.h"
+#include "Systems/PCWeaponAssetStreamer.h"
+#include "GameFramework/GameStateBase.h"
 
 #include "PCCharacter.h"
 
@@ -17,11 +27,33 @@
 static int32 DebugWeaponDrawing = 0;
 FAutoConsoleVariableRef CVARDebugWeaponDrawing(TEXT("PC.DebugWeapons"), DebugWeaponDrawing, TEXT("Draw Debug Lines for Weapons"), ECVF_Cheat);
 
+FOnPCWeaponOwnerChanged APCWeaponBase::OnWeaponOwnerChanged;
+
+namespace
+{
+	// Client timestamps jitter a little, accept shots slightly faster than the fire rate
+	const float FireRateTolerance = 0.75f;
+
+	// Shots that arrive bunched up by the network, the server fire rate bucket holds this many
+	const float MaxFireTokens = 3.0f;
+
+	// How far a client shot timestamp may be ahead of the server clock
+	const float MaxShotTimeAhead = 0.05f;
+
+	// Shot sequences wrap, A is newer if it is less than half the range ahead of B
+	bool IsNewerShotSequence(uint16 A, uint16 B)
+	{
+		return (int16)(A - B) > 0;
+	}
+}
+
 // Sets default values
 APCWeaponBase::APCWeaponBase()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	// Only ticks while the trigger is held, to run the fire schedule
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
 
 	//Create a Skeletal Mesh Component for the Weapon
 	MeshComp = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshComp"));
@@ -36,29 +68,37 @@ APCWeaponBase::APCWeaponBase()
 	PlayerAnimInstance = nullptr;
 	AnimInstance = nullptr;
 
-	ShotCounter = 0;
+	Definition = nullptr;
+	WeaponId = 0;
 
-	// Create audio componenent for playing weapon sounds
-	FireAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("FireAudioComponent"));
-	FireAudioComponent->bAutoActivate = false;
+	MagazineMeshComp = nullptr;
+	MagazineParent = nullptr;
 
-	ShellEjectAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("ShellEjectAudioComponent"));
-	ShellEjectAudioComponent->bAutoActivate = false;
-
-	MagazineAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("MagazineAudioComponent"));
-	MagazineAudioComponent->bAutoActivate = false;
-
-	MagazineEjectAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("MagazineEjectAudioComponent"));
-	MagazineEjectAudioComponent->bAutoActivate = false;
-
-	MagazineInsertAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("MagazineInsertAudioComponent"));
-	MagazineInsertAudioComponent->bAutoActivate = false;
+	ShotCounter = 0;
+	LastFireTime = -BIG_NUMBER;
+	NextShotTime = 0.0f;
+	PreviousScheduleTime = 0.0f;
+	bTriggerHeld = false;
+
+	NextShotSequence = 1;
+	LastAckedShotSequence = 0;
+	FirstShotSinceReload = 1;
+	LastAcceptedShotSequence = 0;
+	LastAcceptedShotTime = -BIG_NUMBER;
+	FireTokens = MaxFireTokens;
+	LastFireTokenTime = 0.0f;
+	AcceptedShotsHead = 0;
+	bReplayingClientShot = false;
+	for (int32 i = 0; i < AcceptedShotHistory; i++)
+	{
+		AcceptedShots[i] = INDEX_NONE;
+	}
 
-	WeaponRaiseAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("WeaponRaiseAudioComponent"));
-	WeaponRaiseAudioComponent->bAutoActivate = false;
+	SignificanceTier = ESignificanceTier::FULL;
 
-	WeaponLowerAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("WeaponLowerAudioComponent"));
-	WeaponLowerAudioComponent->bAutoActivate = false;
+	bUseHitscan = false;
+	HitscanRange = 5000.0f;
+	HitscanDamage = 20.0f;
 }
 
 void APCWeaponBase::BeginPlay()
@@ -67,169 +107,543 @@ void APCWeaponBase::BeginPlay()
 
 	AnimInstance = MeshComp->GetAnimInstance();
 
-	if (FireModes.Num() != 0)
+	RegisterStats();
+
+	CurrentFireMode = GetStats().DefaultFireMode;
+
+	// Nobody sees or hears a dedicated server's weapons
+	if (!PCShouldPlayCosmetics(this))
 	{
-		CurrentFireMode = FireModes[0];
+		SignificanceTier = ESignificanceTier::SKIP;
 	}
-	else {
-		CurrentFireMode = EFiremode::SEMI_AUTO;
+	else if (APCSignificanceManager* SignificanceManager = APCWorldManager::Get<APCSignificanceManager>(this))
+	{
+		SignificanceManager->RegisterWeapon(this);
 	}
 
-	TimeBetweenShots = 60 / RateOfFire;
+	Magazine = FPCMagazineState(MagazineClass);
+	MagazineParent = MeshComp;
+	MagazineParentSocket = MagazineSocketName;
+	UpdateMagazineMesh();
 
-	FireAudioComponent->AttachTo(MeshComp, MuzzleSocketName);
-	ShellEjectAudioComponent->AttachTo(MeshComp, ShellEjectSocketName);
-	MagazineAudioComponent->AttachTo(MeshComp, MagazineSocketName);
-	MagazineEjectAudioComponent->AttachTo(MeshComp, MagazineSocketName);
-	MagazineInsertAudioComponent->AttachTo(MeshComp, MagazineSocketName);
-	WeaponRaiseAudioComponent->AttachTo(MeshComp, MagazineSocketName);
-	WeaponLowerAudioComponent->AttachTo(MeshComp, MagazineSocketName);
+	// Keeps our animations, sounds and effects loaded while we exist, the effects are warmed up once they arrive
+	if (APCWeaponAssetStreamer* AssetStreamer = APCWorldManager::Get<APCWeaponAssetStreamer>(this))
+	{
+		AssetStreamer->AcquireAssets(GetClass());
+	}
 
-	if (FireSound->IsValidLowLevelFast())
+	// Pre-spawn the rounds this weapon fires so the first shots don't hitch
+	if (Magazine.ProjectileClass)
 	{
-		FireAudioComponent->SetSound(FireSound);
+		if (APCProjectilePool* ProjectilePool = APCWorldManager::Get<APCProjectilePool>(this))
+		{
+			ProjectilePool->WarmUp(Magazine.ProjectileClass);
+		}
 	}
+}
 
-	if (ShellEjectSound->IsValidLowLevelFast())
+void APCWeaponBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (APCSignificanceManager* SignificanceManager = APCWorldManager::Find<APCSignificanceManager>(this))
 	{
-		ShellEjectAudioComponent->SetSound(ShellEjectSound);
+		SignificanceManager->UnregisterWeapon(this);
 	}
 
-	if (EmptyMagSound->IsValidLowLevelFast())
+	if (APCWeaponAssetStreamer* AssetStreamer = APCWorldManager::Find<APCWeaponAssetStreamer>(this))
 	{
-		MagazineAudioComponent->SetSound(EmptyMagSound);
+		AssetStreamer->ReleaseAssets(GetClass());
 	}
-	
-	if (MagEjectSound->IsValidLowLevelFast())
+
+	Super::EndPlay(EndPlayReason);
+}
+
+USkeletalMeshComponent* APCWeaponBase::GetGunMeshComp()
+{
+	return MeshComp;
+}
+
+const USkeletalMeshComponent* APCWeaponBase::GetGunMeshComp() const
+{
+	return MeshComp;
+}
+
+/*
+	RegisterStats
+	======================================================================
+	Looks up the row the fire path reads our stats from. Weapons without
+	a definition share one row per class, baked from the class defaults.
+	In the editor the row is baked again for every weapon, as the class
+	defaults can be edited between play sessions without a recompile.
+	======================================================================
+*/
+void APCWeaponBase::RegisterStats()
+{
+	if (Definition)
 	{
-		MagazineEjectAudioComponent->SetSound(MagEjectSound);
+		WeaponId = Definition->GetWeaponId();
+		DamageType = Definition->DamageType;
+		return;
 	}
-	
-	if (MagInsertSound->IsValidLowLevelFast())
+
+	UClass* WeaponClass = GetClass();
+	WeaponId = FPCWeaponStatsTable::Find(WeaponClass);
+#if WITH_EDITOR
+	const bool bBakeStats = true;
+#else
+	const bool bBakeStats = WeaponId == 0;
+#endif
+	if (bBakeStats)
 	{
-		MagazineInsertAudioComponent->SetSound(MagInsertSound);
+		const APCWeaponBase* Defaults = GetDefault<APCWeaponBase>(WeaponClass);
+		WeaponId = FPCWeaponStatsTable::Register(WeaponClass, FPCWeaponStats::Make(Defaults->WeaponType, Defaults->FireModes, Defaults->RateOfFire, Defaults->AimSpeed,
+			Defaults->HipInertiaModifier, Defaults->AimInertiaModifier, Defaults->bUseHitscan, Defaults->HitscanRange, Defaults->HitscanDamage));
 	}
+}
+
+const FPCWeaponStats& APCWeaponBase::GetStats() const
+{
+	return FPCWeaponStatsTable::Get(WeaponId);
+}
 
-	if (WeaponRaiseSound->IsValidLowLevelFast())
+bool APCWeaponBase::CanFireShot() const
+{
+	// Shots remaining check. This one is to ensure firing stops if in the middle of automatic fire
+	if (Magazine.IsEmpty())
 	{
-		WeaponRaiseAudioComponent->SetSound(WeaponRaiseSound);
+		return false;
 	}
 
-	if (WeaponLowerSound->IsValidLowLevelFast())
+	return ((CurrentFireMode == EFiremode::SEMI_AUTO || CurrentFireMode == EFiremode::SINGLE_ACTION) && ShotCounter < 1) || (CurrentFireMode == EFiremode::FULLY_SEMI_AUTO) || (CurrentFireMode == EFiremode::THREE_ROUND_BURST && ShotCounter < 3);
+}
+
+FTransform APCWeaponBase::GetMuzzleTransform() const
+{
+	return MeshComp->GetSocketTransform(MuzzleSocketName);
+}
+
+void APCWeaponBase::Fire()
+{
+	if (CanFireShot())
 	{
-		WeaponLowerAudioComponent->SetSound(WeaponLowerSound);
+		FireShot(GetMuzzleTransform(), GetWorld()->TimeSeconds);
 	}
+}
+
+/*
+	FireShot
+	======================================================================
+	Fires a single round from the given muzzle transform. ShotTime is the
+	exact (possibly sub-frame) time the shot was scheduled for, rounds
+	are advanced by the time that already passed since then.
+	======================================================================
+*/
+void APCWeaponBase::FireShot(const FTransform& MuzzleTransform, float ShotTime)
+{
+	AActor* MyOwner = GetOwner(); // Need to setup in editor PlayerPawn - Set Owner in BP Implementation
+
+	const FVector MuzzleLocation = MuzzleTransform.GetLocation();
+	const FRotator MuzzleRotation = MuzzleTransform.Rotator();
+	const float TimeSinceShot = FMath::Max(GetWorld()->TimeSeconds - ShotTime, 0.0f);
 
-	if (MagazineClass)
+	// Character hits from a client's shots are reported by that client and checked with lag compensation
+	const uint16 ShotSequence = bReplayingClientShot ? LastAcceptedShotSequence : NextShotSequence++;
+	const bool bCharacterHitsReported = bReplayingClientShot || GetNetMode() == NM_Client;
+
+	const FPCWeaponStats& Stats = GetStats();
+
+	if (MyOwner && Stats.bUseHitscan)
 	{
-		FActorSpawnParameters SWSpawnParams;
-		SWSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		CurrentMagazine = GetWorld()->SpawnActor<APCMagazineBase>(MagazineClass, FVector::ZeroVector, FRotator::ZeroRotator, SWSpawnParams);
-		CurrentMagazine->AttachToComponent(MeshComp, FAttachmentTransformRules::SnapToTargetNotIncludingScale, MagazineSocketName);
-		CurrentMagazine->DoGunOffset();
+		// Queue the trace in this frame's batch, it is resolved off the critical path next frame
+		if (APCBallisticsManager* Ballistics = APCWorldManager::Get<APCBallisticsManager>(this))
+		{
+			APawn* InstigatorPawn = Cast<APawn>(MyOwner);
+
+			FPCHitscanParams Hitscan;
+			Hitscan.Start = MuzzleLocation;
+			Hitscan.End = MuzzleLocation + MuzzleRotation.Vector() * Stats.HitscanRange;
+			Hitscan.Damage = Stats.HitscanDamage;
+			Hitscan.DamageType = DamageType;
+			Hitscan.ImpactEffect = ImpactEffect.Get();
+			Hitscan.DamageCauser = this;
+			Hitscan.InstigatorController = InstigatorPawn ? InstigatorPawn->GetController() : nullptr;
+			Hitscan.ShotSequence = ShotSequence;
+			Hitscan.bCharacterHitsReported = bCharacterHitsReported;
+			Ballistics->QueueHitscan(Hitscan);
+		}
+
+		// Increment ShotCounter by 1
+		ShotCounter++;
+
+		// Handle ammo use
+		Magazine.UnloadOneRound();
 	}
-	else
+	else if (MyOwner && Magazine.ProjectileClass)
 	{
-		CurrentMagazine = nullptr;
+		const APCProjectileBase* ProjectileDefaults = Magazine.ProjectileClass->GetDefaultObject<APCProjectileBase>();
+
+		// Shots scheduled earlier in the frame have already travelled a little way
+		const FVector LaunchVelocity = MuzzleRotation.Vector() * ProjectileDefaults->MuzzleVelocity;
+		const FVector LaunchLocation = ProjectileDefaults->bUseBallistics ? MuzzleLocation + LaunchVelocity * TimeSinceShot : MuzzleLocation;
+
+		// Take a Projectile from the pool instead of spawning one per round.
+		// Simulated rounds only need one if they want a visual representation.
+		APCProjectileBase* ProjectileBase = nullptr;
+		if (!ProjectileDefaults->bUseBallistics || ProjectileDefaults->bSpawnRepresentation)
+		{
+			APCProjectilePool* ProjectilePool = APCWorldManager::Get<APCProjectilePool>(this);
+			ProjectileBase = ProjectilePool ? ProjectilePool->AcquireProjectile(Magazine.ProjectileClass, LaunchLocation, MuzzleRotation, MyOwner, Cast<APawn>(MyOwner)) : nullptr;
+			if (ProjectileBase)
+			{
+				ProjectileBase->SetOrigin(MuzzleLocation);
+			}
+		}
+
+		// Hand the round to the batched ballistics simulation
+		if (ProjectileDefaults->bUseBallistics)
+		{
+			if (APCBallisticsManager* Ballistics = APCWorldManager::Get<APCBallisticsManager>(this))
+			{
+				APawn* InstigatorPawn = Cast<APawn>(MyOwner);
+
+				FPCBallisticRoundParams Round;
+				Round.Location = LaunchLocation;
+				Round.Velocity = LaunchVelocity;
+				Round.DragCoefficient = ProjectileDefaults->DragCoefficient;
+				Round.GravityScale = ProjectileDefaults->GravityScale;
+				Round.MaxLifetime = ProjectileDefaults->MaxLifetime;
+				Round.Damage = ProjectileDefaults->BaseDamage;
+				Round.DamageType = DamageType;
+				Round.ImpactEffect = ImpactEffect.Get();
+				Round.DamageCauser = this;
+				Round.InstigatorController = InstigatorPawn ? InstigatorPawn->GetController() : nullptr;
+				Round.Representation = ProjectileBase;
+				Round.ShotSequence = ShotSequence;
+				Round.bCharacterHitsReported = bCharacterHitsReported;
+				Ballistics->AddRound(Round);
+			}
+		}
+
+		// Increment ShotCounter by 1
+		ShotCounter++;
+
+		// Handle ammo use
+		Magazine.UnloadOneRound();
 	}
+
+	// Show the empty magazine once the last round is gone
+	if (Magazine.IsEmpty() && MagazineMeshComp)
+	{
+		UpdateMagazineMesh();
+	}
+
+	if (DebugWeaponDrawing > 0)
+	{
+		DrawDebugDirectionalArrow(GetWorld(), MuzzleLocation, MuzzleLocation + MuzzleRotation.Vector() * 50.0f, 5.0f, FColor::Green, false, 1.0f);
+	}
+
+	// Play other effects, such as muzzle flash, sound, etc.
+	PlayFireEffects();
+
+	// Remote machines see the shot through the owner's event stream, an owning client also sends it to the server
+	if (APCCharacter* OwnerCharacter = Cast<APCCharacter>(MyOwner))
+	{
+		const AGameStateBase* GameState = GetWorld()->GetGameState();
+
+		FPCShotRecord Shot;
+		Shot.Sequence = ShotSequence;
+		Shot.Origin = MuzzleLocation;
+		Shot.Direction = MuzzleRotation.Vector();
+		Shot.ShotTime = GameState ? ShotTime + GameState->GetServerWorldTimeSeconds() - GetWorld()->TimeSeconds : ShotTime;
+		OwnerCharacter->NotifyWeaponFired(Shot);
+	}
+
+	LastFireTime = ShotTime; //Set the last time we fired our weapon (used for fire rate check)
 }
 
-USkeletalMeshComponent* APCWeaponBase::GetGunMeshComp()
+/*
+	PlayRemoteFireEffects
+	======================================================================
+	Cosmetics for shots fired on another machine. A batch of shots from
+	one frame plays the effects once.
+	======================================================================
+*/
+void APCWeaponBase::PlayRemoteFireEffects(int32 ShotCount)
 {
-	return MeshComp;
+	if (ShotCount > 0)
+	{
+		PlayFireEffects();
+	}
 }
 
-void APCWeaponBase::Fire()
+/*
+	ServerFireShot
+	======================================================================
+	Fires a shot the owning client predicted, from the muzzle transform
+	it reported, once the shot passes the same checks the client made:
+	ammo, fire rate, and an origin close to the owner. Accepted shots
+	are remembered so they can report a hit later.
+	The client's timestamp is only trusted within the rewind window
+	around the server clock, and the fire rate is enforced against the
+	server clock too: every shot takes a token from a small bucket that
+	refills at the weapon's fire rate, so a batch of shots with made up
+	timestamps can't empty a magazine in one frame.
+	======================================================================
+*/
+bool APCWeaponBase::ServerFireShot(const FPCShotRecord& Shot)
 {
-	// Shots remaining check. This one is to ensure firing stops if in the middle of automatic fire
-	if (CurrentMagazine == nullptr || CurrentMagazine->IsEmpty())
+	AActor* MyOwner = GetOwner();
+	if (!MyOwner || !IsNewerShotSequence(Shot.Sequence, LastAcceptedShotSequence))
 	{
-		GetWorldTimerManager().ClearTimer(TimerHandle_TimeBetweenShots);
-		ShotCounter = 0;
-		return;
+		return false;
 	}
 
-	if (((CurrentFireMode == EFiremode::SEMI_AUTO || CurrentFireMode == EFiremode::SINGLE_ACTION) && ShotCounter < 1) || (CurrentFireMode == EFiremode::FULLY_SEMI_AUTO) || (CurrentFireMode == EFiremode::THREE_ROUND_BURST && ShotCounter < 3))
+	if (Magazine.IsEmpty())
 	{
-		AActor* MyOwner = GetOwner(); // Need to setup in editor PlayerPawn - Set Owner in BP Implementation
+		return false;
+	}
 
-		if (MyOwner && CurrentMagazine->ProjectileClass)
-		{
-			FVector EyeLocation;
-			FRotator EyeRotation;
-			MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+	// Rewind window and origin tolerance are the ones hits are validated with
+	const APCLagCompensationManager* LagCompensation = APCWorldManager::Get<APCLagCompensationManager>(this);
+	if (!LagCompensation)
+	{
+		return false;
+	}
+
+	const float Now = GetWorld()->TimeSeconds;
+	const float ShotTime = FMath::Clamp(Shot.ShotTime, Now - LagCompensation->MaxRewindTime, Now + MaxShotTimeAhead);
+
+	const float TimeBetweenShots = GetStats().TimeBetweenShots;
+	if (ShotTime - LastAcceptedShotTime < TimeBetweenShots * FireRateTolerance)
+	{
+		return false;
+	}
+
+	if (TimeBetweenShots > KINDA_SMALL_NUMBER)
+	{
+		FireTokens = FMath::Min(FireTokens + (Now - LastFireTokenTime) / TimeBetweenShots, MaxFireTokens);
+	}
+	else
+	{
+		FireTokens = MaxFireTokens;
+	}
+	LastFireTokenTime = Now;
+
+	if (FireTokens < 1.0f)
+	{
+		return false;
+	}
+
+	if (FVector::DistSquared(MyOwner->GetActorLocation(), Shot.Origin) > FMath::Square(LagCompensation->MaxShotOriginError))
+	{
+		return false;
+	}
 
-			FVector MuzzleLocation = MeshComp->GetSocketLocation(MuzzleSocketName);
-			FRotator MuzzleRotation = MeshComp->GetSocketRotation(MuzzleSocketName);
+	LastAcceptedShotSequence = Shot.Sequence;
+	LastAcceptedShotTime = ShotTime;
+	FireTokens -= 1.0f;
 
-			// Spawn Even If Collisions
-			FActorSpawnParameters SpawnParams;
-			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-			SpawnParams.Instigator = Cast<APawn>(MyOwner);
+	AcceptedShots[AcceptedShotsHead] = Shot.Sequence;
+	AcceptedShotsHead = (AcceptedShotsHead + 1) % AcceptedShotHistory;
 
-			// Spawn a Projectile
-			AActor* ProjectileActor = GetWorld()->SpawnActor<AActor>(CurrentMagazine->ProjectileClass, MuzzleLocation, MuzzleRotation, SpawnParams);
-			APCProjectileBase* ProjectileBase = Cast<APCProjectileBase>(ProjectileActor);
-			ProjectileBase->SetOrigin(MeshComp->GetSocketLocation(MuzzleSocketName));
+	bReplayingClientShot = true;
+	FireShot(FTransform(Shot.Direction.GetSafeNormal().Rotation(), Shot.Origin), GetWorld()->TimeSeconds);
+	bReplayingClientShot = false;
 
-			// Increment ShotCounter by 1
-			ShotCounter++;
+	return true;
+}
 
-			// Handle ammo use
-			CurrentMagazine->UnloadOneRound();
+bool APCWeaponBase::ConsumeAcceptedShot(uint16 Sequence)
+{
+	for (int32& AcceptedShot : AcceptedShots)
+	{
+		if (AcceptedShot == Sequence)
+		{
+			AcceptedShot = INDEX_NONE;
+			return true;
 		}
+	}
 
-		if (DebugWeaponDrawing > 0)
+	return false;
+}
+
+/*
+	ReconcileShots
+	======================================================================
+	The server answered for every shot up to AckedSequence. Refused
+	shots are taken back out of the ballistics simulation, and the ammo
+	count becomes the server's minus the shots it has not seen yet.
+	Acks for shots from before a reload are ignored for ammo since the
+	local refill already happened.
+	======================================================================
+*/
+void APCWeaponBase::ReconcileShots(uint16 AckedSequence, const TArray<uint16>& RejectedSequences, int32 ServerRoundsRemaining)
+{
+	// Acks are unreliable, one overtaken by a newer ack says nothing new
+	if (!IsNewerShotSequence(AckedSequence, LastAckedShotSequence))
+	{
+		return;
+	}
+	LastAckedShotSequence = AckedSequence;
+
+	if (RejectedSequences.Num() > 0)
+	{
+		if (APCBallisticsManager* Ballistics = APCWorldManager::Find<APCBallisticsManager>(this))
 		{
-			//Place DEBUG statements here.
+			for (const uint16 Sequence : RejectedSequences)
+			{
+				Ballistics->CancelShot(this, Sequence);
+			}
 		}
+	}
 
-		// Play other effects, such as muzzle flash, sound, etc.
-		PlayFireEffects();
+	if (Magazine.IsValid() && !IsNewerShotSequence(FirstShotSinceReload, AckedSequence))
+	{
+		const uint16 UnackedShots = NextShotSequence - 1 - AckedSequence;
+		Magazine.RoundsRemaining = FMath::Clamp(ServerRoundsRemaining - (int32)UnackedShots, 0, Magazine.MaxCapacity);
+	}
+}
 
-		LastFireTime = GetWorld()->TimeSeconds; //Set the last time we fired our weapon (used for fire rate check)
+float APCWeaponBase::GetShotDamage() const
+{
+	const FPCWeaponStats& Stats = GetStats();
+	if (Stats.bUseHitscan)
+	{
+		return Stats.HitscanDamage;
 	}
+
+	if (Magazine.ProjectileClass)
+	{
+		return Magazine.ProjectileClass->GetDefaultObject<APCProjectileBase>()->BaseDamage;
+	}
+
+	return 0.0f;
+}
+
+TSubclassOf<UDamageType> APCWeaponBase::GetDamageType() const
+{
+	return DamageType;
 }
 
 void APCWeaponBase::StartFire()
 {
 	// Shots remaining check. This one is to ensure the empty sound is played only once.
-	if (CurrentMagazine == nullptr || CurrentMagazine->IsEmpty())
+	if (Magazine.IsEmpty())
 	{
-		if (MagazineAudioComponent)
-		{
-			MagazineAudioComponent->Play();
-		}
+		PlayWeaponSound(EmptyMagSound, MagazineSocketName, 0.6f);
 
 		return;
 	}
 
-	float FirstDelay = FMath::Max(LastFireTime + TimeBetweenShots - GetWorld()->TimeSeconds, 0.0f); //Clamp to 0+
+	const float Now = GetWorld()->TimeSeconds;
+
+	// First shot is due once the previous one has cleared the fire rate
+	NextShotTime = FMath::Max(LastFireTime + GetStats().TimeBetweenShots, Now);
+	PreviousMuzzleTransform = GetMuzzleTransform();
+	PreviousScheduleTime = Now;
+	bTriggerHeld = true;
 
-	//Calls the Fire() function with a delay based on the time last fired (to correspond with fire rate).
-	GetWorldTimerManager().SetTimer(TimerHandle_TimeBetweenShots, this, &APCWeaponBase::Fire, TimeBetweenShots, true, FirstDelay); //Full Auto
+	SetActorTickEnabled(true);
 
+	// Don't wait a frame if the shot is already due
+	UpdateFireSchedule(Now, PreviousMuzzleTransform);
 }
 
 void APCWeaponBase::StopFire()
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_TimeBetweenShots);
+	bTriggerHeld = false;
+	SetActorTickEnabled(false);
 	ShotCounter = 0;
 }
 
+void APCWeaponBase::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UpdateFireSchedule(GetWorld()->TimeSeconds, GetMuzzleTransform());
+}
+
+void APCWeaponBase::SetOwner(AActor* NewOwner)
+{
+	AActor* OldOwner = GetOwner();
+
+	Super::SetOwner(NewOwner);
+
+	if (OldOwner != NewOwner)
+	{
+		OnWeaponOwnerChanged.Broadcast(this, OldOwner, NewOwner);
+	}
+}
+
+/*
+	UpdateFireSchedule
+	======================================================================
+	Pays off the shot debt accumulated since the last update: every shot
+	whose scheduled time has passed is fired now, with its exact
+	timestamp and a muzzle transform interpolated between the previous
+	and current frame. Cadence is therefore independent of frame rate.
+	======================================================================
+*/
+void APCWeaponBase::UpdateFireSchedule(float Now, const FTransform& CurrentMuzzleTransform)
+{
+	const float TimeBetweenShots = GetStats().TimeBetweenShots;
+	const float FrameLength = Now - PreviousScheduleTime;
+	int32 ShotsThisFrame = 0;
+
+	while (bTriggerHeld && NextShotTime <= Now && ShotsThisFrame < MaxShotsPerFrame)
+	{
+		if (!CanFireShot())
+		{
+			// Out of ammo or the fire mode's shot limit is reached, stop scheduling until the trigger is pressed again
+			if (Magazine.IsEmpty())
+			{
+				ShotCounter = 0;
+			}
+
+			bTriggerHeld = false;
+			break;
+		}
+
+		const float Alpha = FrameLength > KINDA_SMALL_NUMBER ? FMath::Clamp((NextShotTime - PreviousScheduleTime) / FrameLength, 0.0f, 1.0f) : 1.0f;
+
+		FTransform MuzzleTransform;
+		MuzzleTransform.Blend(PreviousMuzzleTransform, CurrentMuzzleTransform, Alpha);
+
+		FireShot(MuzzleTransform, NextShotTime);
+
+		NextShotTime += TimeBetweenShots;
+		ShotsThisFrame++;
+	}
+
+	// Drop debt we could not pay this frame (long hitch) rather than bursting it out later
+	if (ShotsThisFrame == MaxShotsPerFrame)
+	{
+		NextShotTime = FMath::Max(NextShotTime, Now);
+	}
+
+	PreviousMuzzleTransform = CurrentMuzzleTransform;
+	PreviousScheduleTime = Now;
+
+	if (!bTriggerHeld)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
 void APCWeaponBase::ChangeFiremode()
 {
-	if (FireModes.Num() <= 1) { //If only one mode or zero, return with current mode;
+	const TArray<EFiremode>& Modes = Definition ? Definition->FireModes : FireModes;
+
+	if (Modes.Num() <= 1) { //If only one mode or zero, return with current mode;
 		return;
 	}
 
-	for (int i = 0; i < FireModes.Num(); i++) {
-		if (CurrentFireMode == FireModes[i] && i < FireModes.Num()-1) { //If found fire mode, increment by 1
-			CurrentFireMode = FireModes[i + 1];
+	for (int i = 0; i < Modes.Num(); i++) {
+		if (CurrentFireMode == Modes[i] && i < Modes.Num()-1) { //If found fire mode, increment by 1
+			CurrentFireMode = Modes[i + 1];
 			break;
 		}
-		else if(i == (FireModes.Num() - 1)) { //If at last index, set to first fire mode
-			CurrentFireMode = FireModes[0];
+		else if(i == (Modes.Num() - 1)) { //If at last index, set to first fire mode
+			CurrentFireMode = Modes[0];
 			break;
 		}
 	}
@@ -238,15 +652,28 @@ void APCWeaponBase::ChangeFiremode()
 
 TArray<EFiremode> APCWeaponBase::GetFireModes()
 {
-	return FireModes;
+	return Definition ? Definition->FireModes : FireModes;
 }
 
 void APCWeaponBase::Reload()
 {
-	if (CurrentMagazine)
-	{
-		CurrentMagazine->Refill();
-	}
+	Magazine.Refill();
+	UpdateMagazineMesh();
+
+	FirstShotSinceReload = NextShotSequence;
+}
+
+void APCWeaponBase::LoadMagazine(const FPCMagazineState& NewMagazine)
+{
+	Magazine = NewMagazine;
+	UpdateMagazineMesh();
+
+	FirstShotSinceReload = NextShotSequence;
+}
+
+TSubclassOf<APCMagazineBase> APCWeaponBase::GetMagazineClass() const
+{
+	return MagazineClass;
 }
 
 void APCWeaponBase::SetPlayerAnimInstance(UAnimInstance* InAnimInstance)
@@ -254,31 +681,60 @@ void APCWeaponBase::SetPlayerAnimInstance(UAnimInstance* InAnimInstance)
 	PlayerAnimInstance = InAnimInstance;
 }
 
+/*
+	PlayFireEffects
+	======================================================================
+	Plays the cosmetic side of a shot, degraded by the significance tier
+	of this weapon (see APCSignificanceManager).
+	======================================================================
+*/
 void APCWeaponBase::PlayFireEffects() {
-	//Play Muzzle Effect
-	if (MuzzleEffect) //prevent crash if unassigned
+#if PC_WITH_COSMETICS
+	if (SignificanceTier == ESignificanceTier::SKIP || !PCShouldPlayCosmetics(this))
 	{
-		UGameplayStatics::SpawnEmitterAttached(MuzzleEffect, MeshComp, MuzzleSocketName);
+		return;
 	}
 
-	//Play the Recoil Animation
-	if (FireAnimation)
+	PlayWeaponSound(FireSound, MuzzleSocketName, 1.0f);
+
+	if (SignificanceTier == ESignificanceTier::MINIMAL)
 	{
-		PlayerAnimInstance->PlaySlotAnimationAsDynamicMontage(FireAnimation, "Shoulders", 0.0f);
+		return;
 	}
 
-	if (SingleFireAnimation && CurrentFireMode == EFiremode::SEMI_AUTO)
+	//Play Muzzle Effect
+	if (UParticleSystem* Muzzle = MuzzleEffect.Get()) //unassigned or still streaming in
 	{
-		AnimInstance->PlaySlotAnimationAsDynamicMontage(SingleFireAnimation, "Fire", 0.0f);
+		if (APCEffectsPool* EffectsPool = APCWorldManager::Get<APCEffectsPool>(this))
+		{
+			EffectsPool->SpawnEffectAttached(Muzzle, MeshComp, MuzzleSocketName);
+		}
 	}
-	else if (AutoFireAnimation && CurrentFireMode == EFiremode::FULLY_SEMI_AUTO)
+
+	if (SignificanceTier == ESignificanceTier::REDUCED)
 	{
-		AnimInstance->PlaySlotAnimationAsDynamicMontage(AutoFireAnimation, "Fire", 0.0f);
+		return;
 	}
 
-	if (FireAudioComponent)
+	//Play the Recoil Animation
+	UAnimSequence* Recoil = FireAnimation.Get();
+	if (Recoil && PlayerAnimInstance)
 	{
-		FireAudioComponent->Play();
+		PlayerAnimInstance->PlaySlotAnimationAsDynamicMontage(Recoil, "Shoulders", 0.0f);
+	}
+
+	if (AnimInstance)
+	{
+		UAnimSequence* SingleFire = SingleFireAnimation.Get();
+		UAnimSequence* AutoFire = AutoFireAnimation.Get();
+		if (SingleFire && CurrentFireMode == EFiremode::SEMI_AUTO)
+		{
+			AnimInstance->PlaySlotAnimationAsDynamicMontage(SingleFire, "Fire", 0.0f);
+		}
+		else if (AutoFire && CurrentFireMode == EFiremode::FULLY_SEMI_AUTO)
+		{
+			AnimInstance->PlaySlotAnimationAsDynamicMontage(AutoFire, "Fire", 0.0f);
+		}
 	}
 
 	//Camera Shake
@@ -291,21 +747,48 @@ void APCWeaponBase::PlayFireEffects() {
 			PC->ClientPlayCameraShake(FireCamShake);
 		}
 	}
+#endif
 }
 
 void APCWeaponBase::PlayShellEjectEffect()
 {
-	if (ShellEjectEffect)
+#if PC_WITH_COSMETICS
+	if (SignificanceTier == ESignificanceTier::SKIP || SignificanceTier == ESignificanceTier::MINIMAL || !PCShouldPlayCosmetics(this))
 	{
-		UGameplayStatics::SpawnEmitterAttached(ShellEjectEffect, MeshComp, ShellEjectSocketName);
+		return;
 	}
 
-	if (ShellEjectAudioComponent)
+	if (UParticleSystem* ShellEject = ShellEjectEffect.Get())
 	{
-		ShellEjectAudioComponent->Play();
+		if (APCEffectsPool* EffectsPool = APCWorldManager::Get<APCEffectsPool>(this))
+		{
+			EffectsPool->SpawnEffectAttached(ShellEject, MeshComp, ShellEjectSocketName);
+		}
+	}
+
+	if (SignificanceTier == ESignificanceTier::FULL)
+	{
+		PlayWeaponSound(ShellEjectSound, ShellEjectSocketName, 0.3f);
+	}
+#endif
+}
+
+void APCWeaponBase::SetSignificanceTier(ESignificanceTier InTier)
+{
+	const bool bWasSkipped = SignificanceTier == ESignificanceTier::SKIP;
+	SignificanceTier = InTier;
+
+	if (bWasSkipped != (SignificanceTier == ESignificanceTier::SKIP))
+	{
+		UpdateMagazineMesh();
 	}
 }
 
+ESignificanceTier APCWeaponBase::GetSignificanceTier() const
+{
+	return SignificanceTier;
+}
+
 void APCWeaponBase::SetAimTransform()
 {
 	RootComponent->SetRelativeLocationAndRotation(AimLocation, AimRotation);
@@ -338,7 +821,7 @@ FVector APCWeaponBase::GetADSOffset()
 
 float APCWeaponBase::GetAimSpeed()
 {
-	return AimSpeed;
+	return GetStats().AimSpeed;
 }
 
 void APCWeaponBase::SetHipTransform()
@@ -351,14 +834,71 @@ void APCWeaponBase::SetZeroTransform()
 	RootComponent->SetRelativeLocationAndRotation(FVector::ZeroVector, FRotator::ZeroRotator);
 }
 
+// Equip and reload montages drive gameplay through their notifies, so they are loaded on the spot if streaming hasn't caught up
 UAnimSequence* APCWeaponBase::GetEquipAnimation()
 {
-	return EquipAnimation;
+	return EquipAnimation.LoadSynchronous();
 }
 
 UAnimSequence* APCWeaponBase::GetReloadAnimation()
 {
-	return ReloadAnimation;
+	return ReloadAnimation.LoadSynchronous();
+}
+
+void APCWeaponBase::GetStreamedAssets(TArray<FSoftObjectPath>& OutAssets, bool bCosmetics) const
+{
+	const TSoftObjectPtr<UAnimSequence>* const GameplayAnimations[] = { &EquipAnimation, &ReloadAnimation };
+	const TSoftObjectPtr<UAnimSequence>* const CosmeticAnimations[] = { &FireAnimation, &SingleFireAnimation, &AutoFireAnimation };
+	const TSoftObjectPtr<UParticleSystem>* const Effects[] = { &MuzzleEffect, &ImpactEffect, &ShellEjectEffect };
+	const TSoftObjectPtr<USoundCue>* const Sounds[] = { &FireSound, &EmptyMagSound, &MagEjectSound, &MagInsertSound, &WeaponRaiseSound, &WeaponLowerSound, &ShellEjectSound };
+
+	for (const TSoftObjectPtr<UAnimSequence>* Asset : GameplayAnimations)
+	{
+		if (!Asset->IsNull())
+		{
+			OutAssets.AddUnique(Asset->ToSoftObjectPath());
+		}
+	}
+
+	if (!bCosmetics)
+	{
+		return;
+	}
+
+	for (const TSoftObjectPtr<UAnimSequence>* Asset : CosmeticAnimations)
+	{
+		if (!Asset->IsNull())
+		{
+			OutAssets.AddUnique(Asset->ToSoftObjectPath());
+		}
+	}
+
+	for (const TSoftObjectPtr<UParticleSystem>* Asset : Effects)
+	{
+		if (!Asset->IsNull())
+		{
+			OutAssets.AddUnique(Asset->ToSoftObjectPath());
+		}
+	}
+
+	for (const TSoftObjectPtr<USoundCue>* Asset : Sounds)
+	{
+		if (!Asset->IsNull())
+		{
+			OutAssets.AddUnique(Asset->ToSoftObjectPath());
+		}
+	}
+}
+
+void APCWeaponBase::GetStreamedEffects(TArray<UParticleSystem*>& OutEffects) const
+{
+	for (UParticleSystem* Effect : { MuzzleEffect.Get(), ShellEjectEffect.Get(), ImpactEffect.Get() })
+	{
+		if (Effect)
+		{
+			OutEffects.AddUnique(Effect);
+		}
+	}
 }
 
 FName APCWeaponBase::GetHolsterSocketName()
@@ -371,39 +911,124 @@ FName APCWeaponBase::GetMagazineSocketName()
 	return MagazineSocketName;
 }
 
-APCMagazineBase* APCWeaponBase::GetCurrentMagazine()
+const FPCMagazineState& APCWeaponBase::GetMagazine() const
 {
-	return CurrentMagazine;
+	return Magazine;
 }
 
-void APCWeaponBase::PlayMagEjectSound()
+/*
+	UpdateMagazineMesh
+	======================================================================
+	Creates the magazine mesh the first time the weapon is seen and
+	unregisters it once nobody does, so weapons out of view keep no
+	render state. The component itself is kept and registered again
+	when the weapon comes back into view.
+	======================================================================
+*/
+void APCWeaponBase::UpdateMagazineMesh()
 {
-	if (MagazineEjectAudioComponent)
+	const APCMagazineBase* MagazineDefaults = Magazine.GetDefaults();
+	UStaticMesh* Mesh = MagazineDefaults ? MagazineDefaults->GetMesh(Magazine.IsEmpty()) : nullptr;
+
+	if (!Mesh || !MagazineParent || SignificanceTier == ESignificanceTier::SKIP || !PCShouldPlayCosmetics(this))
+	{
+		if (MagazineMeshComp && MagazineMeshComp->IsRegistered())
+		{
+			MagazineMeshComp->UnregisterComponent();
+		}
+		return;
+	}
+
+	if (!MagazineMeshComp)
+	{
+		MagazineMeshComp = NewObject<UStaticMeshComponent>(this, TEXT("MagazineMeshComp"));
+		MagazineMeshComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		MagazineMeshComp->SetGenerateOverlapEvents(false);
+		MagazineMeshComp->SetStaticMesh(Mesh);
+		MagazineMeshComp->SetupAttachment(MagazineParent, MagazineParentSocket);
+		MagazineMeshComp->RegisterComponent();
+	}
+	else
+	{
+		MagazineMeshComp->SetStaticMesh(Mesh);
+		MagazineMeshComp->AttachToComponent(MagazineParent, FAttachmentTransformRules::SnapToTargetNotIncludingScale, MagazineParentSocket);
+		if (!MagazineMeshComp->IsRegistered())
+		{
+			MagazineMeshComp->RegisterComponent();
+		}
+	}
+
+	if (MagazineParent == MeshComp)
+	{
+		MagazineMeshComp->SetRelativeLocationAndRotation(MagazineDefaults->GetGunSocketOffsetLocation(), MagazineDefaults->GetGunSocketOffsetRotation());
+	}
+	else
 	{
-		MagazineEjectAudioComponent->Play();
+		MagazineMeshComp->SetRelativeLocationAndRotation(MagazineDefaults->GetHandSocketOffsetLocation(), MagazineDefaults->GetHandSocketOffsetRotation());
 	}
 }
 
-void APCWeaponBase::PlayMagInsertSound()
+void APCWeaponBase::AttachMagazineToHand(USceneComponent* HandMesh, FName HandSocketName)
 {
-	if (MagazineInsertAudioComponent)
+	MagazineParent = HandMesh;
+	MagazineParentSocket = HandSocketName;
+	UpdateMagazineMesh();
+}
+
+void APCWeaponBase::AttachMagazineToWeapon()
+{
+	MagazineParent = MeshComp;
+	MagazineParentSocket = MagazineSocketName;
+	UpdateMagazineMesh();
+}
+
+/*
+	PlayWeaponSound
+	======================================================================
+	Borrows a voice from the shared weapon audio pool for a one-shot
+	sound at the given socket. Sounds of the locally controlled weapon
+	are boosted so distant gunfire does not steal their voices.
+	======================================================================
+*/
+void APCWeaponBase::PlayWeaponSound(const TSoftObjectPtr<USoundCue>& SoundAsset, FName SocketName, float Priority)
+{
+#if PC_WITH_COSMETICS
+	// Not loaded yet is the same as not assigned
+	USoundCue* Sound = SoundAsset.Get();
+	if (!Sound || !PCShouldPlayCosmetics(this))
 	{
-		MagazineInsertAudioComponent->Play();
+		return;
 	}
+
+	APawn* MyOwner = Cast<APawn>(GetOwner());
+	if (MyOwner && MyOwner->IsLocallyControlled())
+	{
+		Priority *= 4.0f;
+	}
+
+	if (APCWeaponAudioPool* AudioPool = APCWorldManager::Get<APCWeaponAudioPool>(this))
+	{
+		AudioPool->PlaySoundAttached(Sound, MeshComp, SocketName, Priority);
+	}
+#endif
+}
+
+void APCWeaponBase::PlayMagEjectSound()
+{
+	PlayWeaponSound(MagEjectSound, MagazineSocketName, 0.5f);
+}
+
+void APCWeaponBase::PlayMagInsertSound()
+{
+	PlayWeaponSound(MagInsertSound, MagazineSocketName, 0.5f);
 }
 
 void APCWeaponBase::PlayWeaponRaiseSound()
 {
-	if (WeaponRaiseAudioComponent)
-	{
-		WeaponRaiseAudioComponent->Play();
-	}
+	PlayWeaponSound(WeaponRaiseSound, MagazineSocketName, 0.4f);
 }
 
 void APCWeaponBase::PlayWeaponLowerSound()
 {
-	if (WeaponLowerAudioComponent)
-	{
-		WeaponLowerAudioComponent->Play();
-	}
+	PlayWeaponSound(WeaponLowerSound, MagazineSocketName, 0.4f);
 }
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PCWeaponDefinition.h"
+#include "UObject/ObjectKey.h"
+
+static_assert(sizeof(FPCWeaponStats) <= PLATFORM_CACHE_LINE_SIZE, "FPCWeaponStats should fit in one cache line");
+
+//////////////////////////////////////////////////////////////////////////
+// FPCWeaponStats
+
+FPCWeaponStats::FPCWeaponStats()
+	: TimeBetweenShots(0.1f)
+	, AimSpeed(8.0f)
+	, HipInertiaModifier(1.0f)
+	, AimInertiaModifier(1.0f)
+	, HitscanRange(5000.0f)
+	, HitscanDamage(20.0f)
+	, DefaultFireMode(EFiremode::SEMI_AUTO)
+	, WeaponType(EWeaponType::LONG_GUN)
+	, bUseHitscan(false)
+{
+}
+
+FPCWeaponStats FPCWeaponStats::Make(EWeaponType InWeaponType, const TArray<EFiremode>& InFireModes, float InRateOfFire, float InAimSpeed, float InHipInertiaModifier, float InAimInertiaModifier, bool bInUseHitscan, float InHitscanRange, float InHitscanDamage)
+{
+	FPCWeaponStats Stats;
+	Stats.TimeBetweenShots = 60.0f / FMath::Max(InRateOfFire, 1.0f);
+	Stats.AimSpeed = InAimSpeed;
+	Stats.HipInertiaModifier = InHipInertiaModifier;
+	Stats.AimInertiaModifier = InAimInertiaModifier;
+	Stats.HitscanRange = InHitscanRange;
+	Stats.HitscanDamage = InHitscanDamage;
+	Stats.WeaponType = InWeaponType;
+	Stats.bUseHitscan = bInUseHitscan;
+
+	if (InFireModes.Num() != 0)
+	{
+		Stats.DefaultFireMode = InFireModes[0];
+	}
+
+	return Stats;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UPCWeaponDefinition
+
+UPCWeaponDefinition::UPCWeaponDefinition()
+{
+	WeaponType = EWeaponType::LONG_GUN;
+	RateOfFire = 600.0f;
+	AimSpeed = 8.0f;
+	HipInertiaModifier = 1.0f;
+	AimInertiaModifier = 1.0f;
+	bUseHitscan = false;
+	HitscanRange = 5000.0f;
+	HitscanDamage = 20.0f;
+
+	WeaponId = 0;
+}
+
+void UPCWeaponDefinition::BakeStats()
+{
+	BakedStats = FPCWeaponStats::Make(WeaponType, FireModes, RateOfFire, AimSpeed, HipInertiaModifier, AimInertiaModifier, bUseHitscan, HitscanRange, HitscanDamage);
+}
+
+uint16 UPCWeaponDefinition::GetWeaponId()
+{
+	if (WeaponId == 0)
+	{
+		WeaponId = FPCWeaponStatsTable::Register(this, BakedStats);
+	}
+
+	return WeaponId;
+}
+
+void UPCWeaponDefinition::PreSave(const ITargetPlatform* TargetPlatform)
+{
+	Super::PreSave(TargetPlatform);
+
+	BakeStats();
+}
+
+void UPCWeaponDefinition::PostLoad()
+{
+	Super::PostLoad();
+
+#if WITH_EDITOR
+	// Uncooked assets may have been saved before their last edit was baked
+	BakeStats();
+#endif
+}
+
+#if WITH_EDITOR
+void UPCWeaponDefinition::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BakeStats();
+
+	// Weapons already using this definition pick the change up straight away
+	if (WeaponId != 0)
+	{
+		FPCWeaponStatsTable::Register(this, BakedStats);
+	}
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// FPCWeaponStatsTable
+
+namespace
+{
+	MS_ALIGN(PLATFORM_CACHE_LINE_SIZE) struct FPCWeaponStatsRow
+	{
+		FPCWeaponStats Stats;
+	} GCC_ALIGN(PLATFORM_CACHE_LINE_SIZE);
+
+	FPCWeaponStatsRow WeaponStatsRows[FPCWeaponStatsTable::MaxWeapons];
+
+	int32 NumWeaponStatsRows = 1; // Row 0 is the default
+
+	FObjectKey WeaponStatsSources[FPCWeaponStatsTable::MaxWeapons]; // Object that last registered each row
+
+	TMap<FName, uint16> WeaponStatsIds; // By source path
+}
+
+uint16 FPCWeaponStatsTable::Register(const UObject* Source, const FPCWeaponStats& Stats)
+{
+	check(IsInGameThread());
+
+	const FName SourcePath(*Source->GetPathName());
+
+	uint16 WeaponId = WeaponStatsIds.FindRef(SourcePath);
+	if (WeaponId == 0)
+	{
+		if (NumWeaponStatsRows >= MaxWeapons)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Weapon stats table is full, %s uses default stats"), *GetNameSafe(Source));
+			return 0;
+		}
+
+		WeaponId = (uint16)NumWeaponStatsRows++;
+		WeaponStatsIds.Add(SourcePath, WeaponId);
+	}
+
+	WeaponStatsSources[WeaponId] = FObjectKey(Source);
+	WeaponStatsRows[WeaponId].Stats = Stats;
+
+	return WeaponId;
+}
+
+uint16 FPCWeaponStatsTable::Find(const UObject* Source)
+{
+	const uint16 WeaponId = WeaponStatsIds.FindRef(FName(*Source->GetPathName()));
+	return WeaponStatsSources[WeaponId] == FObjectKey(Source) ? WeaponId : 0;
+}
+
+const FPCWeaponStats& FPCWeaponStatsTable::Get(uint16 WeaponId)
+{
+	return WeaponStatsRows[WeaponId < NumWeaponStatsRows ? WeaponId : 0].Stats;
+}
@@ -0,0 +1,396 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCBallisticsManager.h"
+#include "ProjectCharlie.h"
+#include "PCProjectileBase.h"
+#include "PCCharacter.h"
+#include "Systems/PCEffectsPool.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/DamageType.h"
+#include "Particles/ParticleSystem.h"
+#include "DrawDebugHelpers.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ballistics Tick"), STAT_BallisticsTick, STATGROUP_ProjectCharlie);
+DECLARE_CYCLE_STAT(TEXT("Ballistics Integrate"), STAT_BallisticsIntegrate, STATGROUP_ProjectCharlie);
+DECLARE_CYCLE_STAT(TEXT("Ballistics Issue Traces"), STAT_BallisticsIssueTraces, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Rounds In Flight"), STAT_BallisticsRounds, STATGROUP_ProjectCharlie);
+
+//Ballistics Debug Command
+static int32 DebugBallisticsDrawing = 0;
+FAutoConsoleVariableRef CVARDebugBallisticsDrawing(TEXT("PC.DebugBallistics"), DebugBallisticsDrawing, TEXT("Draw Debug Lines for simulated rounds"), ECVF_Cheat);
+
+APCBallisticsManager::APCBallisticsManager()
+{
+	// Only ticks while rounds are in flight
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+}
+
+int32 APCBallisticsManager::GetNumRounds() const
+{
+	return Positions.Num();
+}
+
+int32 APCBallisticsManager::AddRound(const FPCBallisticRoundParams& Params)
+{
+	const int32 Index = Positions.Add(Params.Location);
+	PreviousPositions.Add(Params.Location);
+	Velocities.Add(Params.Velocity);
+	DragCoefficients.Add(Params.DragCoefficient);
+	GravityZ.Add(GetWorld()->GetGravityZ() * Params.GravityScale);
+	TimesAlive.Add(0.0f);
+	MaxLifetimes.Add(Params.MaxLifetime);
+
+	FRoundInfo Info;
+	Info.Origin = Params.Location;
+	Info.Damage = Params.Damage;
+	Info.DamageType = Params.DamageType;
+	Info.ImpactEffect = Params.ImpactEffect;
+	Info.DamageCauser = Params.DamageCauser;
+	Info.InstigatorController = Params.InstigatorController;
+	Info.Representation = Params.Representation;
+	Info.ShotSequence = Params.ShotSequence;
+	Info.bCharacterHitsReported = Params.bCharacterHitsReported;
+	Infos.Add(Info);
+
+	PendingRemoval.Add(false);
+
+	INC_DWORD_STAT(STAT_BallisticsRounds);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+
+	return Index;
+}
+
+void APCBallisticsManager::QueueHitscan(const FPCHitscanParams& Params)
+{
+	QueuedHitscans.Add(Params);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+void APCBallisticsManager::CancelShot(const AActor* DamageCauser, uint16 ShotSequence)
+{
+	for (int32 i = 0; i < Positions.Num(); i++)
+	{
+		const FRoundInfo& Info = Infos[i];
+		if (Info.ShotSequence == ShotSequence && Info.DamageCauser.Get() == DamageCauser)
+		{
+			PendingRemoval[i] = true;
+
+			// Hide it now, it goes back to the pool with the removal next tick
+			if (APCProjectileBase* Representation = Info.Representation.Get())
+			{
+				Representation->SetActorHiddenInGame(true);
+			}
+		}
+	}
+
+	QueuedHitscans.RemoveAll([DamageCauser, ShotSequence](const FPCHitscanParams& Hitscan)
+	{
+		return Hitscan.ShotSequence == ShotSequence && Hitscan.DamageCauser.Get() == DamageCauser;
+	});
+
+	// Traces already issued still complete, they just do nothing
+	for (FPCHitscanParams& Hitscan : InFlightHitscans)
+	{
+		if (Hitscan.ShotSequence == ShotSequence && Hitscan.DamageCauser.Get() == DamageCauser)
+		{
+			Hitscan.Damage = 0.0f;
+			Hitscan.ImpactEffect = nullptr;
+			Hitscan.InstigatorController.Reset();
+		}
+	}
+}
+
+bool APCBallisticsManager::HasWork() const
+{
+	return Positions.Num() > 0 || QueuedHitscans.Num() > 0 || HitscanTraces.Num() > 0;
+}
+
+void APCBallisticsManager::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BallisticsTick);
+
+	Super::Tick(DeltaTime);
+
+	// Round indices in last frame's traces are still valid here, rounds are only appended between ticks
+	ConsumeTraceResults();
+	Integrate(DeltaTime);
+	FlagExpiredRounds();
+	RemovePendingRounds();
+	IssueTraces();
+	UpdateRepresentations();
+
+	// Sleep until the next round or hitscan is fired
+	if (!HasWork())
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+/*
+	Integrate
+	======================================================================
+	Semi-implicit Euler step for every round: quadratic air drag plus
+	gravity. Reads and writes flat arrays only so the loop stays tight.
+	======================================================================
+*/
+void APCBallisticsManager::Integrate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BallisticsIntegrate);
+
+	const int32 NumRounds = Positions.Num();
+
+	FVector* RESTRICT Position = Positions.GetData();
+	FVector* RESTRICT PreviousPosition = PreviousPositions.GetData();
+	FVector* RESTRICT Velocity = Velocities.GetData();
+	const float* RESTRICT Drag = DragCoefficients.GetData();
+	const float* RESTRICT Gravity = GravityZ.GetData();
+	float* RESTRICT TimeAlive = TimesAlive.GetData();
+
+	for (int32 i = 0; i < NumRounds; i++)
+	{
+		const FVector V = Velocity[i];
+		const float Speed = V.Size();
+
+		FVector Acceleration = V * (-Drag[i] * Speed);
+		Acceleration.Z += Gravity[i];
+
+		const FVector NewVelocity = V + Acceleration * DeltaTime;
+
+		PreviousPosition[i] = Position[i];
+		Position[i] = Position[i] + NewVelocity * DeltaTime;
+		Velocity[i] = NewVelocity;
+		TimeAlive[i] += DeltaTime;
+	}
+}
+
+void APCBallisticsManager::FlagExpiredRounds()
+{
+	const int32 NumRounds = Positions.Num();
+
+	for (int32 i = 0; i < NumRounds; i++)
+	{
+		if (TimesAlive[i] > MaxLifetimes[i])
+		{
+			PendingRemoval[i] = true;
+		}
+	}
+}
+
+FCollisionQueryParams APCBallisticsManager::MakeQueryParams(AActor* DamageCauser, AActor* Representation) const
+{
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BallisticsTrace), false);
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	if (DamageCauser)
+	{
+		QueryParams.AddIgnoredActor(DamageCauser);
+		QueryParams.AddIgnoredActor(DamageCauser->GetOwner());
+	}
+	if (Representation)
+	{
+		QueryParams.AddIgnoredActor(Representation);
+	}
+
+	return QueryParams;
+}
+
+/*
+	IssueTraces
+	======================================================================
+	Queues one async line trace for the segment each round travelled this
+	frame, plus every hitscan request gathered since the last tick. The
+	physics thread resolves the whole batch and the results are read at
+	the start of the next tick.
+	======================================================================
+*/
+void APCBallisticsManager::IssueTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BallisticsIssueTraces);
+
+	UWorld* World = GetWorld();
+	const int32 NumRounds = Positions.Num();
+
+	RoundTraces.Reset(NumRounds);
+	for (int32 i = 0; i < NumRounds; i++)
+	{
+		const FRoundInfo& Info = Infos[i];
+		const FCollisionQueryParams QueryParams = MakeQueryParams(Info.DamageCauser.Get(), Info.Representation.Get());
+
+		RoundTraces.Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single, PreviousPositions[i], Positions[i], COLLISION_BULLET, QueryParams, FCollisionResponseParams::DefaultResponseParam, nullptr, i));
+
+		if (DebugBallisticsDrawing > 0)
+		{
+			DrawDebugLine(World, PreviousPositions[i], Positions[i], FColor::Yellow, false, 1.0f, 0, 0.5f);
+		}
+	}
+
+	InFlightHitscans = MoveTemp(QueuedHitscans);
+	QueuedHitscans.Reset();
+
+	HitscanTraces.Reset(InFlightHitscans.Num());
+	for (int32 i = 0; i < InFlightHitscans.Num(); i++)
+	{
+		const FPCHitscanParams& Hitscan = InFlightHitscans[i];
+		const FCollisionQueryParams QueryParams = MakeQueryParams(Hitscan.DamageCauser.Get(), nullptr);
+
+		HitscanTraces.Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Hitscan.Start, Hitscan.End, COLLISION_BULLET, QueryParams, FCollisionResponseParams::DefaultResponseParam, nullptr, i));
+
+		if (DebugBallisticsDrawing > 0)
+		{
+			DrawDebugLine(World, Hitscan.Start, Hitscan.End, FColor::Orange, false, 1.0f, 0, 0.5f);
+		}
+	}
+}
+
+/*
+	ConsumeTraceResults
+	======================================================================
+	Reads last frame's trace batch. Rounds that hit something apply
+	their damage and are flagged for removal, hitscan hits apply theirs.
+	======================================================================
+*/
+void APCBallisticsManager::ConsumeTraceResults()
+{
+	UWorld* World = GetWorld();
+	FTraceDatum Datum;
+
+	for (const FTraceHandle& Handle : RoundTraces)
+	{
+		if (!World->QueryTraceData(Handle, Datum) || Datum.OutHits.Num() == 0 || !Datum.OutHits[0].bBlockingHit)
+		{
+			continue;
+		}
+
+		const int32 Index = Datum.UserData;
+		if (!Positions.IsValidIndex(Index) || PendingRemoval[Index])
+		{
+			continue;
+		}
+
+		const FRoundInfo& Info = Infos[Index];
+		ApplyHit(Datum.OutHits[0], Info.Origin, Velocities[Index].GetSafeNormal(), Info.Damage, Info.DamageType, Info.ImpactEffect, Info.DamageCauser.Get(), Info.InstigatorController.Get(), Info.ShotSequence, Info.bCharacterHitsReported);
+		PendingRemoval[Index] = true;
+
+		if (DebugBallisticsDrawing > 0)
+		{
+			DrawDebugPoint(World, Datum.OutHits[0].ImpactPoint, 8.0f, FColor::Red, false, 1.0f);
+		}
+	}
+	RoundTraces.Reset();
+
+	for (const FTraceHandle& Handle : HitscanTraces)
+	{
+		if (!World->QueryTraceData(Handle, Datum) || Datum.OutHits.Num() == 0 || !Datum.OutHits[0].bBlockingHit)
+		{
+			continue;
+		}
+
+		const FPCHitscanParams& Hitscan = InFlightHitscans[Datum.UserData];
+		ApplyHit(Datum.OutHits[0], Hitscan.Start, (Hitscan.End - Hitscan.Start).GetSafeNormal(), Hitscan.Damage, Hitscan.DamageType, Hitscan.ImpactEffect, Hitscan.DamageCauser.Get(), Hitscan.InstigatorController.Get(), Hitscan.ShotSequence, Hitscan.bCharacterHitsReported);
+	}
+	HitscanTraces.Reset();
+	InFlightHitscans.Reset();
+}
+
+void APCBallisticsManager::ApplyHit(const FHitResult& Hit, const FVector& ShotOrigin, const FVector& ShotDirection, float Damage, TSubclassOf<UDamageType> DamageType, UParticleSystem* ImpactEffect, AActor* DamageCauser, AController* InstigatorController, uint16 ShotSequence, bool bCharacterHitsReported)
+{
+	AActor* HitActor = Hit.GetActor();
+	APCCharacter* HitCharacter = Cast<APCCharacter>(HitActor);
+
+	// The shooting client reports character hits, the server validates them against its history and applies the damage
+	if (HitCharacter && bCharacterHitsReported)
+	{
+		APCCharacter* Shooter = InstigatorController ? Cast<APCCharacter>(InstigatorController->GetPawn()) : nullptr;
+		if (Shooter && GetNetMode() == NM_Client)
+		{
+			Shooter->ReportHit(HitCharacter, ShotOrigin, Hit.ImpactPoint, ShotSequence);
+		}
+	}
+	else if (HitActor && Damage > 0.0f)
+	{
+		UGameplayStatics::ApplyPointDamage(HitActor, Damage, ShotDirection, Hit, InstigatorController, DamageCauser, DamageType);
+	}
+
+	if (ImpactEffect)
+	{
+		if (APCEffectsPool* EffectsPool = APCWorldManager::Get<APCEffectsPool>(this))
+		{
+			EffectsPool->SpawnEffectAtLocation(ImpactEffect, Hit.ImpactPoint, Hit.ImpactNormal.Rotation());
+		}
+	}
+}
+
+void APCBallisticsManager::UpdateRepresentations()
+{
+	const int32 NumRounds = Positions.Num();
+
+	for (int32 i = 0; i < NumRounds; i++)
+	{
+		if (APCProjectileBase* Representation = Infos[i].Representation.Get())
+		{
+			Representation->SetActorLocationAndRotation(Positions[i], Velocities[i].Rotation());
+		}
+	}
+}
+
+void APCBallisticsManager::RemovePendingRounds()
+{
+	// Walk backwards so swapping the last round into a removed slot never skips a flagged one
+	for (int32 i = Positions.Num() - 1; i >= 0; i--)
+	{
+		if (PendingRemoval[i])
+		{
+			RemoveRound(i);
+		}
+	}
+}
+
+void APCBallisticsManager::RemoveRound(int32 Index)
+{
+	if (APCProjectileBase* Representation = Infos[Index].Representation.Get())
+	{
+		Representation->ReturnToPool();
+	}
+
+	Positions.RemoveAtSwap(Index, 1, false);
+	PreviousPositions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	DragCoefficients.RemoveAtSwap(Index, 1, false);
+	GravityZ.RemoveAtSwap(Index, 1, false);
+	TimesAlive.RemoveAtSwap(Index, 1, false);
+	MaxLifetimes.RemoveAtSwap(Index, 1, false);
+	Infos.RemoveAtSwap(Index, 1, false);
+
+	// Mirror RemoveAtSwap on the removal flags
+	const int32 LastIndex = PendingRemoval.Num() - 1;
+	PendingRemoval[Index] = PendingRemoval[LastIndex];
+	PendingRemoval.RemoveAt(LastIndex);
+
+	DEC_DWORD_STAT(STAT_BallisticsRounds);
+}
+
+void APCBallisticsManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (int32 i = Positions.Num() - 1; i >= 0; i--)
+	{
+		RemoveRound(i);
+	}
+
+	RoundTraces.Reset();
+	HitscanTraces.Reset();
+	InFlightHitscans.Reset();
+	QueuedHitscans.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
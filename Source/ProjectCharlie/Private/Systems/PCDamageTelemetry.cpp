@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCDamageTelemetry.h"
+#include "ProjectCharlie.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Events"), STAT_DamageEvents, STATGROUP_ProjectCharlie);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Damage Dealt"), STAT_DamageDealt, STATGROUP_ProjectCharlie);
+DECLARE_CYCLE_STAT(TEXT("Damage Telemetry Flush"), STAT_DamageTelemetryFlush, STATGROUP_ProjectCharlie);
+
+//Damage Telemetry Command
+static int32 DamageTelemetryLevel = 1;
+FAutoConsoleVariableRef CVARDamageTelemetryLevel(TEXT("PC.DamageTelemetry"), DamageTelemetryLevel, TEXT("Damage telemetry: 0 off, 1 stat counters, 2 stat counters and a binary log in the project log folder"), ECVF_Default);
+
+namespace
+{
+	const uint32 DamageLogMagic = 0x50434454; // "PCDT"
+	const uint32 DamageLogVersion = 1;
+
+	// Events a frame can hold before the arrays grow
+	const int32 InitialEventCapacity = 64;
+}
+
+APCDamageTelemetry::APCDamageTelemetry()
+{
+	// Only ticks while events wait to be flushed
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	PendingEvents.Reserve(InitialEventCapacity);
+	FlushEvents.Reserve(InitialEventCapacity);
+}
+
+void APCDamageTelemetry::RecordDamage(const AActor* DamagedActor, float Damage, float HealthAfter, const UDamageType* DamageType, const AController* InstigatedBy, const AActor* DamageCauser)
+{
+	if (DamageTelemetryLevel <= 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_DamageEvents);
+	INC_FLOAT_STAT_BY(STAT_DamageDealt, Damage);
+
+	if (DamageTelemetryLevel < 2 || !DamagedActor)
+	{
+		return;
+	}
+
+	if (APCDamageTelemetry* Telemetry = APCWorldManager::Get<APCDamageTelemetry>(DamagedActor))
+	{
+		FPCDamageEvent Event;
+		Event.Time = DamagedActor->GetWorld()->GetTimeSeconds();
+		Event.Damage = Damage;
+		Event.HealthAfter = HealthAfter;
+		Event.DamagedActor = DamagedActor->GetFName();
+		Event.Instigator = InstigatedBy ? InstigatedBy->GetFName() : NAME_None;
+		Event.DamageCauser = DamageCauser ? DamageCauser->GetFName() : NAME_None;
+		Event.DamageType = DamageType ? DamageType->GetClass()->GetFName() : NAME_None;
+		Telemetry->Push(Event);
+	}
+}
+
+void APCDamageTelemetry::Push(const FPCDamageEvent& Event)
+{
+	check(IsInGameThread());
+
+	PendingEvents.Add(Event);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+void APCDamageTelemetry::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	DispatchFlush();
+
+	// Sleep until the next event, unless the last flush was still running
+	if (PendingEvents.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+FString APCDamageTelemetry::GetLogFilename() const
+{
+	return LogFilename;
+}
+
+/*
+	DispatchFlush
+	======================================================================
+	Hands this frame's events to a background task by swapping them
+	into FlushEvents. While the previous flush is still running it owns
+	FlushEvents, so the events stay pending and go out with a later
+	frame. Only one task ever writes the log.
+	======================================================================
+*/
+void APCDamageTelemetry::DispatchFlush()
+{
+	if (PendingEvents.Num() == 0 || (LastFlushTask.IsValid() && !LastFlushTask->IsComplete()))
+	{
+		return;
+	}
+
+	if (LogFilename.IsEmpty())
+	{
+		LogFilename = FPaths::ProjectLogDir() / FString::Printf(TEXT("DamageTelemetry-%s-%s.bin"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+	}
+
+	// FlushEvents was emptied by the last flush, the swap keeps both allocations
+	Swap(PendingEvents, FlushEvents);
+
+	LastFlushTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]()
+	{
+		FlushPendingEvents();
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+}
+
+void APCDamageTelemetry::WaitForFlush()
+{
+	if (LastFlushTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(LastFlushTask);
+		LastFlushTask = nullptr;
+	}
+}
+
+void APCDamageTelemetry::FlushPendingEvents()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DamageTelemetryFlush);
+
+	if (!LogWriter.IsValid())
+	{
+		LogWriter.Reset(IFileManager::Get().CreateFileWriter(*LogFilename, FILEWRITE_AllowRead));
+		if (!LogWriter.IsValid())
+		{
+			FlushEvents.Reset();
+			return;
+		}
+
+		uint32 Magic = DamageLogMagic;
+		uint32 Version = DamageLogVersion;
+		*LogWriter << Magic << Version;
+	}
+
+	for (FPCDamageEvent& Event : FlushEvents)
+	{
+		FString DamagedActor = Event.DamagedActor.ToString();
+		FString Instigator = Event.Instigator.ToString();
+		FString DamageCauser = Event.DamageCauser.ToString();
+		FString DamageType = Event.DamageType.ToString();
+
+		*LogWriter << Event.Time << Event.Damage << Event.HealthAfter << DamagedActor << Instigator << DamageCauser << DamageType;
+	}
+
+	FlushEvents.Reset();
+
+	LogWriter->Flush();
+}
+
+void APCDamageTelemetry::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Write whatever is left and wait for it, the tasks reference this actor
+	WaitForFlush();
+	DispatchFlush();
+	WaitForFlush();
+
+	if (LogWriter.IsValid())
+	{
+		LogWriter->Close();
+		LogWriter.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
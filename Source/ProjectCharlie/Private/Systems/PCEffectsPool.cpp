@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCEffectsPool.h"
+#include "ProjectCharlie.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effects Culled"), STAT_EffectsCulled, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effects Recycled At Cap"), STAT_EffectsRecycled, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effects Components Created"), STAT_EffectsCreated, STATGROUP_ProjectCharlie);
+
+APCEffectsPool::APCEffectsPool()
+{
+	WarmUpSize = 4;
+	MaxInstancesPerTemplate = 16;
+	CullDistance = 10000.0f;
+}
+
+void APCEffectsPool::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (TPair<UParticleSystem*, FPCEffectsPoolBucket>& Pair : Buckets)
+	{
+		for (UParticleSystemComponent* PSC : Pair.Value.Free)
+		{
+			if (PSC)
+			{
+				PSC->DestroyComponent();
+			}
+		}
+		for (UParticleSystemComponent* PSC : Pair.Value.Active)
+		{
+			if (PSC)
+			{
+				PSC->DestroyComponent();
+			}
+		}
+	}
+	Buckets.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool APCEffectsPool::ShouldCull(const FVector& Location) const
+{
+	// Nothing to see on a dedicated server
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		return true;
+	}
+
+	if (CullDistance <= 0.0f)
+	{
+		return false;
+	}
+
+	APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	if (PC && PC->IsLocalController())
+	{
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		return FVector::DistSquared(ViewLocation, Location) > FMath::Square(CullDistance);
+	}
+
+	return false;
+}
+
+UParticleSystemComponent* APCEffectsPool::CreateComponent(UParticleSystem* Template)
+{
+	UParticleSystemComponent* PSC = NewObject<UParticleSystemComponent>(this);
+	PSC->bAutoActivate = false;
+	PSC->bAutoDestroy = false;
+	PSC->SetTemplate(Template);
+	PSC->OnSystemFinished.AddDynamic(this, &APCEffectsPool::HandleSystemFinished);
+	PSC->RegisterComponent();
+
+	INC_DWORD_STAT(STAT_EffectsCreated);
+
+	return PSC;
+}
+
+void APCEffectsPool::WarmUp(UParticleSystem* Template)
+{
+	if (!Template || Buckets.Contains(Template) || GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	FPCEffectsPoolBucket& Bucket = Buckets.Add(Template);
+	for (int32 i = 0; i < WarmUpSize; i++)
+	{
+		Bucket.Free.Add(CreateComponent(Template));
+	}
+}
+
+void APCEffectsPool::ReleaseTemplate(UParticleSystem* Template)
+{
+	FPCEffectsPoolBucket* Bucket = Buckets.Find(Template);
+	if (!Bucket)
+	{
+		return;
+	}
+
+	for (UParticleSystemComponent* PSC : Bucket->Free)
+	{
+		if (PSC)
+		{
+			PSC->DestroyComponent();
+		}
+	}
+
+	Buckets.Remove(Template);
+}
+
+UParticleSystemComponent* APCEffectsPool::AcquireComponent(UParticleSystem* Template)
+{
+	WarmUp(Template);
+
+	FPCEffectsPoolBucket& Bucket = Buckets.FindOrAdd(Template);
+	UParticleSystemComponent* PSC = nullptr;
+
+	while (!PSC && Bucket.Free.Num() > 0)
+	{
+		PSC = Bucket.Free.Pop(false);
+	}
+
+	if (!PSC)
+	{
+		if (MaxInstancesPerTemplate > 0 && Bucket.Active.Num() >= MaxInstancesPerTemplate)
+		{
+			// At the cap, restart the oldest instance instead of adding another
+			PSC = Bucket.Active[0];
+			Bucket.Active.RemoveAt(0, 1, false);
+			PSC->DeactivateImmediate();
+			INC_DWORD_STAT(STAT_EffectsRecycled);
+		}
+		else
+		{
+			PSC = CreateComponent(Template);
+		}
+	}
+
+	Bucket.Active.Add(PSC);
+
+	return PSC;
+}
+
+UParticleSystemComponent* APCEffectsPool::SpawnEffectAttached(UParticleSystem* Template, USceneComponent* AttachToComponent, FName SocketName)
+{
+	if (!Template || !AttachToComponent)
+	{
+		return nullptr;
+	}
+
+	if (ShouldCull(AttachToComponent->GetSocketLocation(SocketName)))
+	{
+		INC_DWORD_STAT(STAT_EffectsCulled);
+		return nullptr;
+	}
+
+	UParticleSystemComponent* PSC = AcquireComponent(Template);
+	PSC->AttachToComponent(AttachToComponent, FAttachmentTransformRules::SnapToTargetNotIncludingScale, SocketName);
+	PSC->SetRelativeScale3D(FVector::OneVector);
+	PSC->Activate(true);
+
+	return PSC;
+}
+
+UParticleSystemComponent* APCEffectsPool::SpawnEffectAtLocation(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation)
+{
+	if (!Template)
+	{
+		return nullptr;
+	}
+
+	if (ShouldCull(Location))
+	{
+		INC_DWORD_STAT(STAT_EffectsCulled);
+		return nullptr;
+	}
+
+	UParticleSystemComponent* PSC = AcquireComponent(Template);
+	PSC->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	PSC->SetWorldLocationAndRotation(Location, Rotation);
+	PSC->Activate(true);
+
+	return PSC;
+}
+
+void APCEffectsPool::HandleSystemFinished(UParticleSystemComponent* PSC)
+{
+	if (!PSC)
+	{
+		return;
+	}
+
+	FPCEffectsPoolBucket* Bucket = Buckets.Find(PSC->Template);
+	if (Bucket && Bucket->Active.Remove(PSC) > 0)
+	{
+		// Detach so destroyed weapons don't take pooled components with them
+		PSC->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		Bucket->Free.Add(PSC);
+	}
+	else if (!Bucket && PSC->GetOwner() == this)
+	{
+		// Its template was released while it played
+		PSC->DestroyComponent();
+	}
+}
@@ -0,0 +1,309 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCInteractableRegistry.h"
+#include "ProjectCharlie.h"
+#include "Interactable.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "EngineUtils.h"
+
+DECLARE_CYCLE_STAT(TEXT("Interactable Query"), STAT_InteractableQuery, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Registered Interactables"), STAT_RegisteredInteractables, STATGROUP_ProjectCharlie);
+
+APCInteractableRegistry::APCInteractableRegistry()
+{
+	CellSize = 500.0f;
+}
+
+void APCInteractableRegistry::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		OnActorSpawned(*It);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &APCInteractableRegistry::OnActorSpawned));
+	FWorldDelegates::LevelAddedToWorld.AddUObject(this, &APCInteractableRegistry::OnLevelAdded);
+}
+
+void APCInteractableRegistry::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	FWorldDelegates::LevelAddedToWorld.RemoveAll(this);
+
+	for (int32 Index = Entries.GetMaxIndex() - 1; Index >= 0; Index--)
+	{
+		if (Entries.IsAllocated(Index))
+		{
+			RemoveEntry(Index);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APCInteractableRegistry::OnActorSpawned(AActor* Actor)
+{
+	if (Actor && Actor->GetClass()->ImplementsInterface(UInteractable::StaticClass()))
+	{
+		RegisterInteractable(Actor);
+	}
+}
+
+void APCInteractableRegistry::OnLevelAdded(ULevel* Level, UWorld* World)
+{
+	if (Level && World == GetWorld())
+	{
+		for (AActor* Actor : Level->Actors)
+		{
+			OnActorSpawned(Actor);
+		}
+	}
+}
+
+FIntVector APCInteractableRegistry::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void APCInteractableRegistry::RegisterInteractable(AActor* Actor)
+{
+	if (!Actor || Actor->IsPendingKillPending())
+	{
+		return;
+	}
+
+	// A stale entry can still hold the address of a destroyed actor
+	if (const int32* ExistingIndex = EntryIndices.Find(Actor))
+	{
+		if (Entries[*ExistingIndex].Actor.Get() == Actor)
+		{
+			return;
+		}
+		RemoveEntry(*ExistingIndex);
+	}
+
+	FEntry NewEntry;
+	NewEntry.Actor = Actor;
+	NewEntry.Key = Actor;
+	NewEntry.Center = Actor->GetActorLocation();
+	NewEntry.Radius = 0.0f;
+
+	const int32 Index = Entries.Add(NewEntry);
+	EntryIndices.Add(Actor, Index);
+	LinkEntry(Index);
+
+	// Static actors never move, everything else reports back when its root does
+	USceneComponent* Root = Actor->GetRootComponent();
+	if (Root && Root->Mobility != EComponentMobility::Static)
+	{
+		Entries[Index].MovedHandle = Root->TransformUpdated.AddUObject(this, &APCInteractableRegistry::OnInteractableMoved);
+	}
+
+	UpdateEntry(Index);
+
+	SET_DWORD_STAT(STAT_RegisteredInteractables, Entries.Num());
+}
+
+void APCInteractableRegistry::UnregisterInteractable(AActor* Actor)
+{
+	if (const int32* Index = EntryIndices.Find(Actor))
+	{
+		RemoveEntry(*Index);
+	}
+}
+
+void APCInteractableRegistry::LinkEntry(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+
+	Entry.bOversize = Entry.Radius > CellSize;
+	if (Entry.bOversize)
+	{
+		OversizeEntries.Add(Index);
+	}
+	else
+	{
+		Entry.Cell = GetCell(Entry.Center);
+		Cells.FindOrAdd(Entry.Cell).Add(Index);
+	}
+}
+
+void APCInteractableRegistry::UnlinkEntry(int32 Index)
+{
+	const FEntry& Entry = Entries[Index];
+
+	if (Entry.bOversize)
+	{
+		OversizeEntries.RemoveSwap(Index);
+	}
+	else if (TArray<int32>* Cell = Cells.Find(Entry.Cell))
+	{
+		Cell->RemoveSwap(Index);
+		if (Cell->Num() == 0)
+		{
+			Cells.Remove(Entry.Cell);
+		}
+	}
+}
+
+void APCInteractableRegistry::RemoveEntry(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+
+	UnlinkEntry(Index);
+
+	AActor* Actor = Entry.Actor.Get();
+	if (Actor && Actor->GetRootComponent() && Entry.MovedHandle.IsValid())
+	{
+		Actor->GetRootComponent()->TransformUpdated.Remove(Entry.MovedHandle);
+	}
+
+	EntryIndices.Remove(Entry.Key);
+	Entries.RemoveAt(Index);
+
+	SET_DWORD_STAT(STAT_RegisteredInteractables, Entries.Num());
+}
+
+void APCInteractableRegistry::UpdateEntry(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+
+	AActor* Actor = Entry.Actor.Get();
+	if (!Actor)
+	{
+		return;
+	}
+
+	FVector Origin;
+	FVector Extent;
+	Actor->GetActorBounds(false, Origin, Extent);
+
+	const FVector NewCenter = Extent.IsZero() ? Actor->GetActorLocation() : Origin;
+	const float NewRadius = Extent.Size();
+
+	// Only refile when the entry changes cell or moves in or out of the oversize list
+	const bool bNewOversize = NewRadius > CellSize;
+	const bool bRelink = bNewOversize != Entry.bOversize || (!bNewOversize && GetCell(NewCenter) != Entry.Cell);
+	if (bRelink)
+	{
+		UnlinkEntry(Index);
+	}
+
+	Entry.Center = NewCenter;
+	Entry.Radius = NewRadius;
+
+	if (bRelink)
+	{
+		LinkEntry(Index);
+	}
+}
+
+void APCInteractableRegistry::OnInteractableMoved(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (const int32* Index = EntryIndices.Find(Component->GetOwner()))
+	{
+		UpdateEntry(*Index);
+	}
+}
+
+/*
+	FindInteractableInCone
+	======================================================================
+	Visits the cells within Range (plus one cell, the most a filed
+	entry's bounds reach out of its cell) of Origin, then the oversize
+	entries, and keeps the candidate whose center is closest to
+	Direction. A candidate's bounds sphere widens the cone by the angle
+	it covers. Entries whose actor is gone are dropped on the way.
+	======================================================================
+*/
+AActor* APCInteractableRegistry::FindInteractableInCone(const FVector& Origin, const FVector& Direction, float Range, float HalfAngleDegrees, const AActor* IgnoreActor)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InteractableQuery);
+
+	const FVector Axis = Direction.GetSafeNormal();
+	const float HalfAngle = FMath::DegreesToRadians(HalfAngleDegrees);
+	const float Reach = Range + CellSize;
+	const FIntVector MinCell = GetCell(Origin - FVector(Reach));
+	const FIntVector MaxCell = GetCell(Origin + FVector(Reach));
+
+	AActor* BestActor = nullptr;
+	float BestCos = -2.0f;
+	TArray<int32, TInlineAllocator<4>> StaleEntries;
+
+	auto VisitEntry = [&](int32 Index)
+	{
+		const FEntry& Entry = Entries[Index];
+
+		AActor* Actor = Entry.Actor.Get();
+		if (!Actor || Actor->IsPendingKillPending())
+		{
+			StaleEntries.Add(Index);
+			return;
+		}
+
+		if (Actor == IgnoreActor)
+		{
+			return;
+		}
+
+		const FVector ToCenter = Entry.Center - Origin;
+		const float Distance = ToCenter.Size();
+		if (Distance - Entry.Radius > Range)
+		{
+			return;
+		}
+
+		// Standing inside the bounds counts as looking straight at it
+		const float CenterCos = Distance > Entry.Radius ? (ToCenter | Axis) / Distance : 1.0f;
+		if (CenterCos < 1.0f)
+		{
+			const float CenterAngle = FMath::Acos(FMath::Max(CenterCos, -1.0f));
+			const float BoundsAngle = FMath::Asin(Entry.Radius / Distance);
+			if (CenterAngle - BoundsAngle > HalfAngle)
+			{
+				return;
+			}
+		}
+
+		if (CenterCos > BestCos)
+		{
+			BestCos = CenterCos;
+			BestActor = Actor;
+		}
+	};
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+			{
+				if (const TArray<int32>* Cell = Cells.Find(FIntVector(X, Y, Z)))
+				{
+					for (const int32 Index : *Cell)
+					{
+						VisitEntry(Index);
+					}
+				}
+			}
+		}
+	}
+
+	for (const int32 Index : OversizeEntries)
+	{
+		VisitEntry(Index);
+	}
+
+	for (const int32 Index : StaleEntries)
+	{
+		RemoveEntry(Index);
+	}
+
+	return BestActor;
+}
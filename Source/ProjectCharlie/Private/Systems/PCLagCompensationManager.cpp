@@ -0,0 +1,393 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCLagCompensationManager.h"
+#include "ProjectCharlie.h"
+#include "PCCharacter.h"
+#include "Engine/World.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "Kismet/GameplayStatics.h"
+#include "DrawDebugHelpers.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_LagCompensationRecord, STATGROUP_ProjectCharlie);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Validate"), STAT_LagCompensationValidate, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits Validated"), STAT_LagCompensationValidated, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits Rejected"), STAT_LagCompensationRejected, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Lag Compensated Characters"), STAT_LagCompensationCharacters, STATGROUP_ProjectCharlie);
+
+//Lag Compensation Debug Command
+static int32 DebugLagCompensationDrawing = 0;
+FAutoConsoleVariableRef CVARDebugLagCompensationDrawing(TEXT("PC.DebugLagCompensation"), DebugLagCompensationDrawing, TEXT("Draw the rewound hitboxes of validated hits (green accepted, red rejected)"), ECVF_Cheat);
+
+namespace
+{
+	// Reported impact points sit on the hitbox surface, test a little past them
+	const float ShotExtension = 50.0f;
+}
+
+APCLagCompensationManager::APCLagCompensationManager()
+{
+	// Record after physics so the snapshot matches what was sent to clients this frame
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	MaxRewindTime = 0.25f;
+	ProxyInterpolationDelay = 0.1f;
+	HitboxTolerance = 5.0f;
+	MaxShotOriginError = 250.0f;
+}
+
+void APCLagCompensationManager::RegisterCharacter(APCCharacter* Character)
+{
+	if (!Character || HistoryIndices.Contains(Character))
+	{
+		return;
+	}
+
+	const int32 Index = Histories.AddDefaulted();
+	FHistory& History = Histories[Index];
+	History.Character = Character;
+	History.Head = INDEX_NONE;
+	History.Num = 0;
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	for (int32 i = 0; i < MaxHitboxes; i++)
+	{
+		const bool bValid = Mesh && Hitboxes.IsValidIndex(i);
+		const FBodyInstance* Body = bValid ? Mesh->GetBodyInstance(Hitboxes[i].BoneName) : nullptr;
+
+		History.BoneIndices[i] = bValid ? Mesh->GetBoneIndex(Hitboxes[i].BoneName) : INDEX_NONE;
+		History.BodyIndices[i] = Body ? Body->InstanceBodyIndex : INDEX_NONE;
+	}
+
+	HistoryIndices.Add(Character, Index);
+
+	INC_DWORD_STAT(STAT_LagCompensationCharacters);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+void APCLagCompensationManager::UnregisterCharacter(APCCharacter* Character)
+{
+	int32 Index;
+	if (!HistoryIndices.RemoveAndCopyValue(Character, Index))
+	{
+		return;
+	}
+
+	Histories.RemoveAtSwap(Index, 1, false);
+
+	// Point the history swapped into the freed slot at its new index
+	if (Histories.IsValidIndex(Index))
+	{
+		HistoryIndices.Add(Histories[Index].Character.Get(), Index);
+	}
+
+	DEC_DWORD_STAT(STAT_LagCompensationCharacters);
+}
+
+void APCLagCompensationManager::QueueHitValidation(const FPCHitValidationRequest& Request)
+{
+	PendingRequests.Add(Request);
+}
+
+void APCLagCompensationManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Last frame's occlusion traces are done, then record and validate this frame
+	ApplyConfirmedHits();
+	RecordSnapshots();
+	ValidatePendingHits();
+
+	// Sleep once nobody is left to record
+	if (Histories.Num() == 0 && OcclusionTraces.Num() == 0)
+	{
+		PendingRequests.Reset();
+		SetActorTickEnabled(false);
+	}
+}
+
+/*
+	RecordSnapshots
+	======================================================================
+	Writes this frame's hitbox centers for every character into the next
+	slot of its ring buffer, overwriting the oldest snapshot.
+	======================================================================
+*/
+void APCLagCompensationManager::RecordSnapshots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRecord);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const int32 NumHitboxes = FMath::Min(Hitboxes.Num(), MaxHitboxes);
+
+	for (FHistory& History : Histories)
+	{
+		const APCCharacter* Character = History.Character.Get();
+		const USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+		if (!Mesh)
+		{
+			continue;
+		}
+
+		History.Head = (History.Head + 1) % HistoryCapacity;
+		History.Num = FMath::Min(History.Num + 1, HistoryCapacity);
+
+		FSnapshot& Snapshot = History.Snapshots[History.Head];
+		Snapshot.Time = Now;
+		Snapshot.Location = Character->GetActorLocation();
+		Snapshot.BoundsRadius = 0.0f;
+
+		for (int32 i = 0; i < NumHitboxes; i++)
+		{
+			const int32 BoneIndex = History.BoneIndices[i];
+			const FVector Center = BoneIndex != INDEX_NONE ? Mesh->GetBoneTransform(BoneIndex).GetLocation() : Snapshot.Location;
+
+			Snapshot.HitboxCenters[i] = Center;
+			Snapshot.BoundsRadius = FMath::Max(Snapshot.BoundsRadius, FVector::Dist(Center, Snapshot.Location) + Hitboxes[i].Radius);
+		}
+	}
+}
+
+/*
+	GetRewoundSnapshot
+	======================================================================
+	Finds the two snapshots around Time and blends between them. Times
+	outside the recorded window use the oldest or newest snapshot.
+	======================================================================
+*/
+bool APCLagCompensationManager::GetRewoundSnapshot(const FHistory& History, float Time, FSnapshot& OutSnapshot) const
+{
+	if (History.Num == 0)
+	{
+		return false;
+	}
+
+	const FSnapshot* Newer = &History.Snapshots[History.Head];
+	if (Time >= Newer->Time || History.Num == 1)
+	{
+		OutSnapshot = *Newer;
+		return true;
+	}
+
+	// Walk back from the newest snapshot until we pass Time
+	for (int32 Age = 1; Age < History.Num; Age++)
+	{
+		const FSnapshot* Older = &History.Snapshots[(History.Head - Age + HistoryCapacity) % HistoryCapacity];
+		if (Older->Time <= Time)
+		{
+			const float Span = Newer->Time - Older->Time;
+			const float Alpha = Span > KINDA_SMALL_NUMBER ? (Time - Older->Time) / Span : 1.0f;
+
+			OutSnapshot.Time = Time;
+			OutSnapshot.Location = FMath::Lerp(Older->Location, Newer->Location, Alpha);
+			OutSnapshot.BoundsRadius = FMath::Max(Older->BoundsRadius, Newer->BoundsRadius);
+			for (int32 i = 0; i < MaxHitboxes; i++)
+			{
+				OutSnapshot.HitboxCenters[i] = FMath::Lerp(Older->HitboxCenters[i], Newer->HitboxCenters[i], Alpha);
+			}
+			return true;
+		}
+
+		Newer = Older;
+	}
+
+	OutSnapshot = *Newer;
+	return true;
+}
+
+int32 APCLagCompensationManager::TraceHitboxes(const FSnapshot& Snapshot, const FVector& Start, const FVector& End, FVector& OutImpactPoint) const
+{
+	// Broad phase, skip the hitboxes if the shot passes nowhere near the character
+	if (FMath::PointDistToSegment(Snapshot.Location, Start, End) > Snapshot.BoundsRadius + HitboxTolerance)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 NumHitboxes = FMath::Min(Hitboxes.Num(), MaxHitboxes);
+
+	int32 ClosestHitbox = INDEX_NONE;
+	float ClosestDistSquared = BIG_NUMBER;
+
+	for (int32 i = 0; i < NumHitboxes; i++)
+	{
+		const FVector& Center = Snapshot.HitboxCenters[i];
+		const FVector Closest = FMath::ClosestPointOnSegment(Center, Start, End);
+		const float Radius = Hitboxes[i].Radius + HitboxTolerance;
+
+		if (FVector::DistSquared(Closest, Center) > FMath::Square(Radius))
+		{
+			continue;
+		}
+
+		// The first hitbox along the shot wins
+		const float DistSquared = FVector::DistSquared(Start, Closest);
+		if (DistSquared < ClosestDistSquared)
+		{
+			ClosestDistSquared = DistSquared;
+			ClosestHitbox = i;
+			OutImpactPoint = Closest;
+		}
+	}
+
+	return ClosestHitbox;
+}
+
+/*
+	ValidatePendingHits
+	======================================================================
+	Checks every hit reported since the last tick. Requests are sorted by
+	target so each character's history is looked up once per frame no
+	matter how many shots hit it. Hits that land on the rewound hitboxes
+	get an async trace against world geometry and are applied next tick.
+	======================================================================
+*/
+void APCLagCompensationManager::ValidatePendingHits()
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationValidate);
+
+	ConfirmedHits.Reset();
+	OcclusionTraces.Reset();
+
+	if (PendingRequests.Num() == 0)
+	{
+		return;
+	}
+
+	PendingRequests.Sort([](const FPCHitValidationRequest& A, const FPCHitValidationRequest& B)
+	{
+		return A.HitCharacter.Get() < B.HitCharacter.Get();
+	});
+
+	UWorld* World = GetWorld();
+	const float Now = World->GetTimeSeconds();
+
+	const APCCharacter* CurrentTarget = nullptr;
+	const FHistory* CurrentHistory = nullptr;
+
+	for (const FPCHitValidationRequest& Request : PendingRequests)
+	{
+		const APCCharacter* Target = Request.HitCharacter.Get();
+		if (Target != CurrentTarget)
+		{
+			CurrentTarget = Target;
+			const int32* Index = HistoryIndices.Find(Target);
+			CurrentHistory = Index ? &Histories[*Index] : nullptr;
+		}
+
+		// The shot has to start roughly where the shooter is now
+		const AController* InstigatorController = Request.InstigatorController.Get();
+		const APawn* Shooter = InstigatorController ? InstigatorController->GetPawn() : nullptr;
+		const bool bValidOrigin = Shooter && FVector::DistSquared(Shooter->GetActorLocation(), Request.ShotStart) <= FMath::Square(MaxShotOriginError);
+
+		const float RewindTime = FMath::Clamp(Request.RewindTime, Now - MaxRewindTime, Now);
+		const FVector ShotDirection = (Request.ShotEnd - Request.ShotStart).GetSafeNormal();
+		const FVector ShotEnd = Request.ShotEnd + ShotDirection * ShotExtension;
+
+		FSnapshot Snapshot;
+		FVector ImpactPoint;
+		int32 HitboxIndex = INDEX_NONE;
+
+		if (CurrentHistory && bValidOrigin && GetRewoundSnapshot(*CurrentHistory, RewindTime, Snapshot))
+		{
+			HitboxIndex = TraceHitboxes(Snapshot, Request.ShotStart, ShotEnd, ImpactPoint);
+
+			if (DebugLagCompensationDrawing > 0)
+			{
+				const FColor Color = HitboxIndex != INDEX_NONE ? FColor::Green : FColor::Red;
+				for (int32 i = 0; i < FMath::Min(Hitboxes.Num(), MaxHitboxes); i++)
+				{
+					DrawDebugSphere(World, Snapshot.HitboxCenters[i], Hitboxes[i].Radius, 8, Color, false, 2.0f);
+				}
+				DrawDebugLine(World, Request.ShotStart, ShotEnd, Color, false, 2.0f, 0, 0.5f);
+			}
+		}
+
+		if (HitboxIndex == INDEX_NONE)
+		{
+			INC_DWORD_STAT(STAT_LagCompensationRejected);
+			continue;
+		}
+
+		FConfirmedHit ConfirmedHit;
+		ConfirmedHit.Request = Request;
+		ConfirmedHit.ImpactPoint = ImpactPoint;
+		ConfirmedHit.HitboxIndex = HitboxIndex;
+		ConfirmedHit.BodyIndex = CurrentHistory->BodyIndices[HitboxIndex];
+		const int32 HitIndex = ConfirmedHits.Add(ConfirmedHit);
+
+		// Only static geometry can block, characters and weapons are not where the trace would find them
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(LagCompensationTrace), false);
+		QueryParams.AddIgnoredActor(Request.DamageCauser.Get());
+		QueryParams.AddIgnoredActor(Shooter);
+
+		OcclusionTraces.Add(World->AsyncLineTraceByObjectType(EAsyncTraceType::Test, Request.ShotStart, ImpactPoint, FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams, nullptr, HitIndex));
+	}
+
+	PendingRequests.Reset();
+}
+
+void APCLagCompensationManager::ApplyConfirmedHits()
+{
+	UWorld* World = GetWorld();
+	FTraceDatum Datum;
+
+	for (const FTraceHandle& Handle : OcclusionTraces)
+	{
+		if (!World->QueryTraceData(Handle, Datum) || !ConfirmedHits.IsValidIndex(Datum.UserData))
+		{
+			continue;
+		}
+
+		// A test trace returns a hit if anything was in the way
+		if (Datum.OutHits.Num() > 0)
+		{
+			INC_DWORD_STAT(STAT_LagCompensationRejected);
+			continue;
+		}
+
+		const FConfirmedHit& ConfirmedHit = ConfirmedHits[Datum.UserData];
+		const FPCHitValidationRequest& Request = ConfirmedHit.Request;
+
+		APCCharacter* HitCharacter = Request.HitCharacter.Get();
+		if (!HitCharacter || Request.Damage <= 0.0f)
+		{
+			continue;
+		}
+
+		const FVector ShotDirection = (ConfirmedHit.ImpactPoint - Request.ShotStart).GetSafeNormal();
+
+		FHitResult Hit(HitCharacter, HitCharacter->GetMesh(), ConfirmedHit.ImpactPoint, -ShotDirection);
+		Hit.bBlockingHit = true;
+		Hit.TraceStart = Request.ShotStart;
+		Hit.TraceEnd = ConfirmedHit.ImpactPoint;
+		Hit.BoneName = Hitboxes.IsValidIndex(ConfirmedHit.HitboxIndex) ? Hitboxes[ConfirmedHit.HitboxIndex].BoneName : NAME_None;
+		Hit.Item = ConfirmedHit.BodyIndex; // Lets limb health skip the bone name lookup
+
+		UGameplayStatics::ApplyPointDamage(HitCharacter, Request.Damage, ShotDirection, Hit, Request.InstigatorController.Get(), Request.DamageCauser.Get(), Request.DamageType);
+
+		INC_DWORD_STAT(STAT_LagCompensationValidated);
+	}
+
+	OcclusionTraces.Reset();
+	ConfirmedHits.Reset();
+}
+
+void APCLagCompensationManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT_BY(STAT_LagCompensationCharacters, Histories.Num());
+
+	Histories.Empty();
+	HistoryIndices.Empty();
+	PendingRequests.Empty();
+	ConfirmedHits.Empty();
+	OcclusionTraces.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCLoadoutSpawner.h"
+#include "Systems/PCWeaponAssetStreamer.h"
+#include "ProjectCharlie.h"
+#include "PCCharacter.h"
+#include "PCWeaponBase.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Loadout Spawning"), STAT_LoadoutSpawning, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pending Loadout Weapons"), STAT_PendingLoadoutWeapons, STATGROUP_ProjectCharlie);
+
+APCLoadoutSpawner::APCLoadoutSpawner()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	FrameBudgetMs = 2.0f;
+	MinSpawnsPerFrame = 1;
+}
+
+void APCLoadoutSpawner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (FRequest& Request : Requests)
+	{
+		if (Request.LoadHandle.IsValid())
+		{
+			Request.LoadHandle->CancelHandle();
+		}
+	}
+	Requests.Empty();
+
+	SET_DWORD_STAT(STAT_PendingLoadoutWeapons, 0);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APCLoadoutSpawner::RequestWeapon(APCCharacter* Character, TSoftClassPtr<APCWeaponBase> WeaponClass, EPCLoadoutSlot Slot)
+{
+	if (!Character || WeaponClass.IsNull())
+	{
+		return;
+	}
+
+	FRequest& Request = Requests.AddDefaulted_GetRef();
+	Request.Character = Character;
+	Request.WeaponClass = WeaponClass;
+	Request.Slot = Slot;
+	Request.bPrefetched = false;
+
+	if (UClass* LoadedClass = WeaponClass.Get())
+	{
+		PrefetchWeaponAssets(Request, LoadedClass);
+	}
+	else
+	{
+		Request.LoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(WeaponClass.ToSoftObjectPath(), FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+	}
+
+	SET_DWORD_STAT(STAT_PendingLoadoutWeapons, Requests.Num());
+
+	SetActorTickEnabled(true);
+}
+
+void APCLoadoutSpawner::PrefetchWeaponAssets(FRequest& Request, UClass* WeaponClass)
+{
+	if (Request.bPrefetched)
+	{
+		return;
+	}
+
+	if (APCWeaponAssetStreamer* AssetStreamer = APCWorldManager::Get<APCWeaponAssetStreamer>(this))
+	{
+		AssetStreamer->PrefetchAssets(WeaponClass);
+	}
+	Request.bPrefetched = true;
+}
+
+/*
+	Tick
+	======================================================================
+	Spawns loaded weapons oldest request first until the budget is spent.
+	Requests still loading keep their place in the queue, ones whose
+	character is gone or whose class failed to load are dropped.
+	======================================================================
+*/
+void APCLoadoutSpawner::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_LoadoutSpawning);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = FrameBudgetMs * 0.001;
+	int32 NumSpawned = 0;
+
+	for (int32 i = 0; i < Requests.Num();)
+	{
+		FRequest& Request = Requests[i];
+
+		APCCharacter* Character = Request.Character.Get();
+		if (!Character || Character->IsPendingKillPending())
+		{
+			Requests.RemoveAt(i, 1, false);
+			continue;
+		}
+
+		UClass* WeaponClass = Request.WeaponClass.Get();
+		if (!WeaponClass)
+		{
+			if (Request.LoadHandle.IsValid() && Request.LoadHandle->IsLoadingInProgress())
+			{
+				i++;
+				continue;
+			}
+
+			UE_LOG(LogTemp, Warning, TEXT("Loadout weapon %s for %s failed to load"), *Request.WeaponClass.ToString(), *Character->GetName());
+			Requests.RemoveAt(i, 1, false);
+			continue;
+		}
+
+		// Start streaming the weapon's assets while it waits for its turn
+		PrefetchWeaponAssets(Request, WeaponClass);
+
+		if (NumSpawned >= MinSpawnsPerFrame && FPlatformTime::Seconds() - StartTime >= Budget)
+		{
+			break;
+		}
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.Owner = Character;
+		SpawnParams.Instigator = Character;
+
+		APCWeaponBase* Weapon = GetWorld()->SpawnActor<APCWeaponBase>(WeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+		const EPCLoadoutSlot Slot = Request.Slot;
+		Requests.RemoveAt(i, 1, false);
+		NumSpawned++;
+
+		if (Weapon)
+		{
+			Character->OnLoadoutWeaponSpawned(Slot, Weapon);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_PendingLoadoutWeapons, Requests.Num());
+
+	if (Requests.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
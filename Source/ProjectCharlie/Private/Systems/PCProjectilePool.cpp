@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCProjectilePool.h"
+#include "ProjectCharlie.h"
+#include "PCProjectileBase.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Hits"), STAT_ProjectilePoolHits, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Misses"), STAT_ProjectilePoolMisses, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles In Use"), STAT_ProjectilePoolInUse, STATGROUP_ProjectCharlie);
+
+//Projectile Pool Stats Command
+static FAutoConsoleCommandWithWorld CmdDumpProjectilePool(
+	TEXT("PC.ProjectilePool.Stats"),
+	TEXT("Log projectile pool hit/miss stats for the current world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (APCProjectilePool* Pool = APCWorldManager::Find<APCProjectilePool>(World))
+		{
+			Pool->LogPoolStats();
+		}
+	}));
+
+APCProjectilePool::APCProjectilePool()
+{
+	DefaultWarmUpSize = 16;
+	bGrowOnDemand = true;
+	MaxPoolSize = 0;
+	ShrinkInterval = 30.0f;
+}
+
+void APCProjectilePool::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (ShrinkInterval > 0.0f)
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_Shrink, this, &APCProjectilePool::Shrink, ShrinkInterval, true);
+	}
+}
+
+void APCProjectilePool::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_Shrink);
+
+	for (TPair<UClass*, FPCProjectilePoolBucket>& Pair : Buckets)
+	{
+		for (APCProjectileBase* Projectile : Pair.Value.Free)
+		{
+			if (Projectile && !Projectile->IsPendingKill())
+			{
+				Projectile->Destroy();
+			}
+		}
+	}
+	Buckets.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 APCProjectilePool::GetWarmUpSize(UClass* ProjectileClass) const
+{
+	const int32* Size = WarmUpSizes.Find(ProjectileClass);
+	return Size ? *Size : DefaultWarmUpSize;
+}
+
+APCProjectileBase* APCProjectilePool::SpawnPooledProjectile(UClass* ProjectileClass)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	APCProjectileBase* Projectile = GetWorld()->SpawnActor<APCProjectileBase>(ProjectileClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+	if (Projectile)
+	{
+		Projectile->SetPool(this);
+	}
+
+	return Projectile;
+}
+
+void APCProjectilePool::WarmUp(TSubclassOf<APCProjectileBase> ProjectileClass)
+{
+	if (ProjectileClass && !Buckets.Contains(ProjectileClass))
+	{
+		WarmUpCount(ProjectileClass, GetWarmUpSize(ProjectileClass));
+	}
+}
+
+void APCProjectilePool::WarmUpCount(TSubclassOf<APCProjectileBase> ProjectileClass, int32 Count)
+{
+	if (!ProjectileClass)
+	{
+		return;
+	}
+
+	FPCProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+
+	if (MaxPoolSize > 0)
+	{
+		Count = FMath::Min(Count, MaxPoolSize - Bucket.InUse);
+	}
+
+	while (Bucket.Free.Num() < Count)
+	{
+		APCProjectileBase* Projectile = SpawnPooledProjectile(ProjectileClass);
+		if (!Projectile)
+		{
+			break;
+		}
+
+		Projectile->OnReleasedToPool();
+		Bucket.Free.Add(Projectile);
+	}
+}
+
+APCProjectileBase* APCProjectilePool::AcquireProjectile(TSubclassOf<APCProjectileBase> ProjectileClass, const FVector& Location, const FRotator& Rotation, AActor* InOwner, APawn* InInstigator)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	FPCProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+	APCProjectileBase* Projectile = nullptr;
+
+	// Skip anything that was destroyed behind the pool's back
+	while (!Projectile && Bucket.Free.Num() > 0)
+	{
+		Projectile = Bucket.Free.Pop(false);
+		if (!Projectile || Projectile->IsPendingKill())
+		{
+			Projectile = nullptr;
+			Bucket.Stats.Lost++;
+		}
+	}
+
+	if (Projectile)
+	{
+		Bucket.Stats.Hits++;
+		INC_DWORD_STAT(STAT_ProjectilePoolHits);
+	}
+	else
+	{
+		const bool bAtCap = MaxPoolSize > 0 && Bucket.InUse >= MaxPoolSize;
+		if (!bGrowOnDemand || bAtCap)
+		{
+			Bucket.Stats.Refused++;
+			return nullptr;
+		}
+
+		Projectile = SpawnPooledProjectile(ProjectileClass);
+		if (!Projectile)
+		{
+			return nullptr;
+		}
+
+		Bucket.Stats.Misses++;
+		INC_DWORD_STAT(STAT_ProjectilePoolMisses);
+	}
+
+	Bucket.InUse++;
+	Bucket.PeakInUseSinceShrink = FMath::Max(Bucket.PeakInUseSinceShrink, Bucket.InUse);
+	Bucket.Stats.PeakInUse = FMath::Max(Bucket.Stats.PeakInUse, Bucket.InUse);
+	INC_DWORD_STAT(STAT_ProjectilePoolInUse);
+
+	Projectile->SetOwner(InOwner);
+	Projectile->Instigator = InInstigator;
+	Projectile->OnAcquiredFromPool(Location, Rotation);
+
+	return Projectile;
+}
+
+void APCProjectilePool::ReleaseProjectile(APCProjectileBase* Projectile)
+{
+	if (!Projectile || Projectile->IsPendingKill())
+	{
+		return;
+	}
+
+	FPCProjectilePoolBucket& Bucket = Buckets.FindOrAdd(Projectile->GetClass());
+	Bucket.InUse = FMath::Max(Bucket.InUse - 1, 0);
+	DEC_DWORD_STAT(STAT_ProjectilePoolInUse);
+
+	Projectile->OnReleasedToPool();
+	Projectile->SetOwner(nullptr);
+	Projectile->Instigator = nullptr;
+
+	Bucket.Free.Add(Projectile);
+}
+
+void APCProjectilePool::NotifyProjectileLost(APCProjectileBase* Projectile)
+{
+	// Buckets are already gone while the pool itself is torn down
+	FPCProjectilePoolBucket* Bucket = Projectile ? Buckets.Find(Projectile->GetClass()) : nullptr;
+	if (!Bucket || Bucket->InUse <= 0)
+	{
+		return;
+	}
+
+	Bucket->InUse--;
+	Bucket->Stats.Lost++;
+	DEC_DWORD_STAT(STAT_ProjectilePoolInUse);
+}
+
+/*
+	Shrink
+	======================================================================
+	Destroys idle projectiles that were not needed during the last
+	interval, never going below the class warm-up size.
+	======================================================================
+*/
+void APCProjectilePool::Shrink()
+{
+	for (TPair<UClass*, FPCProjectilePoolBucket>& Pair : Buckets)
+	{
+		FPCProjectilePoolBucket& Bucket = Pair.Value;
+
+		const int32 KeepFree = FMath::Max(GetWarmUpSize(Pair.Key), Bucket.PeakInUseSinceShrink - Bucket.InUse);
+		while (Bucket.Free.Num() > KeepFree)
+		{
+			APCProjectileBase* Projectile = Bucket.Free.Pop(false);
+			if (Projectile && !Projectile->IsPendingKill())
+			{
+				Projectile->Destroy();
+			}
+		}
+
+		Bucket.PeakInUseSinceShrink = Bucket.InUse;
+	}
+}
+
+FPCProjectilePoolStats APCProjectilePool::GetPoolStats(TSubclassOf<APCProjectileBase> ProjectileClass) const
+{
+	const FPCProjectilePoolBucket* Bucket = Buckets.Find(ProjectileClass);
+	return Bucket ? Bucket->Stats : FPCProjectilePoolStats();
+}
+
+void APCProjectilePool::LogPoolStats() const
+{
+	for (const TPair<UClass*, FPCProjectilePoolBucket>& Pair : Buckets)
+	{
+		const FPCProjectilePoolBucket& Bucket = Pair.Value;
+		UE_LOG(LogTemp, Log, TEXT("ProjectilePool %s: Free %d, InUse %d, Peak %d, Hits %d, Misses %d, Refused %d, Lost %d"),
+			*GetNameSafe(Pair.Key), Bucket.Free.Num(), Bucket.InUse, Bucket.Stats.PeakInUse,
+			Bucket.Stats.Hits, Bucket.Stats.Misses, Bucket.Stats.Refused, Bucket.Stats.Lost);
+	}
+}
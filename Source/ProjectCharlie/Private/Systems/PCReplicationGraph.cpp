@@ -0,0 +1,508 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCReplicationGraph.h"
+#include "ProjectCharlie.h"
+#include "PCCharacter.h"
+#include "PCWeaponBase.h"
+#include "Systems/PCWorldManager.h"
+#include "ReplicationGraphTypes.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("RepGraph ServerReplicateActors"), STAT_PCRepGraphReplicate, STATGROUP_ProjectCharlie);
+
+//Replication Graph Stats Command
+static FAutoConsoleCommandWithWorld CmdDumpRepGraph(
+	TEXT("PC.RepGraph.Stats"),
+	TEXT("Log server replication time per frame for the current world's replication graph, then reset the counters"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (UPCReplicationGraph* Graph = NetDriver ? Cast<UPCReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+		{
+			Graph->LogReplicationStats();
+		}
+	}));
+
+UPCReplicationGraph::UPCReplicationGraph()
+{
+	GridCellSize = 10000.0f;
+	SpatialBiasX = -150000.0f;
+	SpatialBiasY = -200000.0f;
+	bDisableSpatialRebuilding = true;
+	ViewPriorityUpdateFrames = 6;
+	MaxViewPeriodMultiplier = 8;
+	LowBandwidthNetSpeed = 10000;
+
+	TotalReplicateSeconds = 0.0;
+	PeakReplicateSeconds = 0.0;
+	ReplicateFrames = 0;
+	FramesSinceViewPriorityUpdate = 0;
+}
+
+/*
+	InitGlobalActorClassSettings
+	======================================================================
+	Decide a routing policy for every replicated class and convert each
+	class's NetUpdateFrequency/NetCullDistanceSquared into graph
+	replication settings.
+	======================================================================
+*/
+void UPCReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Owner relevant actors handled by the per connection node
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EClassRepNodeMapping::NOT_ROUTED);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EClassRepNodeMapping::NOT_ROUTED);
+	ClassRepNodePolicies.Set(APCWorldManager::StaticClass(), EClassRepNodeMapping::NOT_ROUTED);
+
+	// Replicate as dependents of their owner, see AddDependentActor()
+	ClassRepNodePolicies.Set(APCWeaponBase::StaticClass(), EClassRepNodeMapping::NOT_ROUTED);
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (!ActorCDO || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+
+		// Skip blueprint compile artifacts
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		if (!ClassRepNodePolicies.Contains(Class, false))
+		{
+			ClassRepNodePolicies.Set(Class, ComputeMappingPolicy(Class));
+		}
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.DistancePriorityScale = 1.0f;
+		ClassInfo.StarvationPriorityScale = 1.0f;
+		ClassInfo.ActorChannelFrameTimeout = 4;
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrame(ActorCDO->NetUpdateFrequency);
+		ClassInfo.CullDistanceSquared = ActorCDO->NetCullDistanceSquared;
+
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+uint32 UPCReplicationGraph::GetReplicationPeriodFrame(float NetUpdateFrequency) const
+{
+	const float ServerTickRate = NetDriver ? NetDriver->NetServerMaxTickRate : 30.0f;
+	return FMath::Max<uint32>(1, FMath::RoundToInt(ServerTickRate / FMath::Max(NetUpdateFrequency, 0.1f)));
+}
+
+void UPCReplicationGraph::NotifyNetUpdateFrequencyChanged(AActor* Actor)
+{
+	UNetDriver* ActorNetDriver = Actor ? Actor->GetNetDriver() : nullptr;
+	UPCReplicationGraph* Graph = ActorNetDriver ? Cast<UPCReplicationGraph>(ActorNetDriver->GetReplicationDriver()) : nullptr;
+	if (!Graph)
+	{
+		return;
+	}
+
+	const uint32 ReplicationPeriodFrame = Graph->GetReplicationPeriodFrame(Actor->NetUpdateFrequency);
+
+	if (FGlobalActorReplicationInfo* GlobalInfo = Graph->GlobalActorReplicationInfoMap.Find(Actor))
+	{
+		GlobalInfo->Settings.ReplicationPeriodFrame = ReplicationPeriodFrame;
+	}
+
+	// Connections copy the period when they first see the actor, the ones that already have it need it too
+	for (UNetReplicationGraphConnection* ConnectionManager : Graph->Connections)
+	{
+		if (FConnectionReplicationActorInfo* ConnectionInfo = ConnectionManager ? ConnectionManager->ActorInfoMap.Find(Actor) : nullptr)
+		{
+			ConnectionInfo->ReplicationPeriodFrame = ReplicationPeriodFrame;
+		}
+	}
+}
+
+EClassRepNodeMapping UPCReplicationGraph::ComputeMappingPolicy(const UClass* Class) const
+{
+	const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+
+	if (ActorCDO->bAlwaysRelevant)
+	{
+		return EClassRepNodeMapping::RELEVANT_ALL_CONNECTIONS;
+	}
+
+	if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		return EClassRepNodeMapping::RELEVANT_OWNER_CONNECTION;
+	}
+
+	if (Class->IsChildOf(AInfo::StaticClass()))
+	{
+		return EClassRepNodeMapping::RELEVANT_ALL_CONNECTIONS;
+	}
+
+	if (ActorCDO->NetDormancy > DORM_Awake)
+	{
+		return EClassRepNodeMapping::SPATIALIZE_DORMANCY;
+	}
+
+	if (Class->IsChildOf(APawn::StaticClass()) || ActorCDO->bReplicateMovement)
+	{
+		return EClassRepNodeMapping::SPATIALIZE_DYNAMIC;
+	}
+
+	return EClassRepNodeMapping::SPATIALIZE_STATIC;
+}
+
+EClassRepNodeMapping UPCReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	// Classes loaded after init inherit from their closest known parent
+	const EClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Class);
+	return Policy ? *Policy : EClassRepNodeMapping::SPATIALIZE_DYNAMIC;
+}
+
+bool UPCReplicationGraph::IsDependentClass(const UClass* Class) const
+{
+	return Class->IsChildOf(APCWeaponBase::StaticClass());
+}
+
+void UPCReplicationGraph::InitGlobalGraphNodes()
+{
+	PreAllocateRepList(3, 12);
+	PreAllocateRepList(6, 12);
+	PreAllocateRepList(128, 64);
+	PreAllocateRepList(512, 16);
+
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = FVector2D(SpatialBiasX, SpatialBiasY);
+
+	if (bDisableSpatialRebuilding)
+	{
+		GridNode->AddSpatialRebuildBlacklistClass(AActor::StaticClass());
+	}
+
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	APCWeaponBase::OnWeaponOwnerChanged.AddUObject(this, &UPCReplicationGraph::HandleWeaponOwnerChanged);
+}
+
+void UPCReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// The connection's controller, pawn and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantConnectionNode, RepGraphConnection);
+
+	// Other actors only relevant to this connection
+	UReplicationGraphNode_ActorList* OwnerRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddConnectionGraphNode(OwnerRelevantNode, RepGraphConnection);
+	OwnerRelevantNodes.Add(RepGraphConnection, OwnerRelevantNode);
+}
+
+void UPCReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection)
+{
+	for (auto It = OwnerRelevantNodes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key() || It.Key()->NetConnection == NetConnection)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Actors that outlive their owner's connection wait for a new one
+	for (auto It = OwnerRelevantConnections.CreateIterator(); It; ++It)
+	{
+		if (!It.Value() || It.Value()->NetConnection == NetConnection)
+		{
+			PendingOwnerRelevantActors.Add(FNewReplicatedActorInfo(It.Key()));
+			It.RemoveCurrent();
+		}
+	}
+
+	Super::RemoveClientConnection(NetConnection);
+}
+
+bool UPCReplicationGraph::RouteOwnerRelevantActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	UNetConnection* OwnerConnection = ActorInfo.Actor->GetNetConnection();
+	if (!OwnerConnection)
+	{
+		return false;
+	}
+
+	for (const TPair<UNetReplicationGraphConnection*, UReplicationGraphNode_ActorList*>& Pair : OwnerRelevantNodes)
+	{
+		if (Pair.Key && Pair.Key->NetConnection == OwnerConnection)
+		{
+			Pair.Value->NotifyAddNetworkActor(ActorInfo);
+			OwnerRelevantConnections.Add(ActorInfo.Actor, Pair.Key);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void UPCReplicationGraph::UnrouteOwnerRelevantActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	PendingOwnerRelevantActors.RemoveAllSwap([&ActorInfo](const FNewReplicatedActorInfo& Pending) { return Pending.Actor == ActorInfo.Actor; });
+
+	UNetReplicationGraphConnection* ConnectionManager = nullptr;
+	if (OwnerRelevantConnections.RemoveAndCopyValue(ActorInfo.Actor, ConnectionManager))
+	{
+		if (UReplicationGraphNode_ActorList* OwnerRelevantNode = OwnerRelevantNodes.FindRef(ConnectionManager))
+		{
+			OwnerRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		}
+	}
+}
+
+/*
+	UpdateOwnerRelevantActors
+	======================================================================
+	Nothing tells the graph when an actor changes owner, so every frame
+	the owner-only actors whose owning connection is no longer the one
+	whose list they are in are taken out of it and queued again. Queued
+	actors go to the list of their owning connection once they have one.
+	======================================================================
+*/
+void UPCReplicationGraph::UpdateOwnerRelevantActors()
+{
+	for (auto It = OwnerRelevantConnections.CreateIterator(); It; ++It)
+	{
+		if (It.Key()->GetNetConnection() != It.Value()->NetConnection)
+		{
+			const FNewReplicatedActorInfo ActorInfo(It.Key());
+			if (UReplicationGraphNode_ActorList* OwnerRelevantNode = OwnerRelevantNodes.FindRef(It.Value()))
+			{
+				OwnerRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+			}
+
+			PendingOwnerRelevantActors.Add(ActorInfo);
+			It.RemoveCurrent();
+		}
+	}
+
+	for (int32 Index = PendingOwnerRelevantActors.Num() - 1; Index >= 0; Index--)
+	{
+		if (RouteOwnerRelevantActor(PendingOwnerRelevantActors[Index]))
+		{
+			PendingOwnerRelevantActors.RemoveAtSwap(Index);
+		}
+	}
+}
+
+void UPCReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	if (APCCharacter* Character = Cast<APCCharacter>(ActorInfo.Actor))
+	{
+		ViewPrioritizedCharacters.AddUnique(Character);
+	}
+
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::NOT_ROUTED:
+		if (IsDependentClass(ActorInfo.Class))
+		{
+			AddDependentActor(ActorInfo.Actor->GetOwner(), ActorInfo.Actor);
+		}
+		break;
+
+	case EClassRepNodeMapping::RELEVANT_ALL_CONNECTIONS:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::RELEVANT_OWNER_CONNECTION:
+		if (!RouteOwnerRelevantActor(ActorInfo))
+		{
+			PendingOwnerRelevantActors.Add(ActorInfo);
+		}
+		break;
+
+	case EClassRepNodeMapping::SPATIALIZE_STATIC:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case EClassRepNodeMapping::SPATIALIZE_DYNAMIC:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	case EClassRepNodeMapping::SPATIALIZE_DORMANCY:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	}
+}
+
+void UPCReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	if (APCCharacter* Character = Cast<APCCharacter>(ActorInfo.Actor))
+	{
+		ViewPrioritizedCharacters.RemoveSwap(Character);
+	}
+
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::NOT_ROUTED:
+		if (IsDependentClass(ActorInfo.Class))
+		{
+			RemoveDependentActor(ActorInfo.Actor->GetOwner(), ActorInfo.Actor);
+		}
+		break;
+
+	case EClassRepNodeMapping::RELEVANT_ALL_CONNECTIONS:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::RELEVANT_OWNER_CONNECTION:
+		UnrouteOwnerRelevantActor(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::SPATIALIZE_STATIC:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::SPATIALIZE_DYNAMIC:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	case EClassRepNodeMapping::SPATIALIZE_DORMANCY:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	}
+}
+
+void UPCReplicationGraph::AddDependentActor(AActor* Parent, AActor* Child)
+{
+	if (!Parent || !Child || !Parent->GetIsReplicated() || !Child->GetIsReplicated())
+	{
+		return;
+	}
+
+	FGlobalActorReplicationInfo& ParentInfo = GlobalActorReplicationInfoMap.Get(Parent);
+	ParentInfo.DependentActorList.PrepareForWrite();
+	ParentInfo.DependentActorList.ConditionalAdd(Child);
+}
+
+void UPCReplicationGraph::RemoveDependentActor(AActor* Parent, AActor* Child)
+{
+	if (!Parent || !Child)
+	{
+		return;
+	}
+
+	if (FGlobalActorReplicationInfo* ParentInfo = GlobalActorReplicationInfoMap.Find(Parent))
+	{
+		ParentInfo->DependentActorList.PrepareForWrite();
+		ParentInfo->DependentActorList.Remove(Child);
+	}
+}
+
+// Weapons change hands when picked up or equipped, move them to the new owner's dependent list
+void UPCReplicationGraph::HandleWeaponOwnerChanged(APCWeaponBase* Weapon, AActor* OldOwner, AActor* NewOwner)
+{
+	if (!Weapon || Weapon->GetWorld() != GetWorld())
+	{
+		return;
+	}
+
+	RemoveDependentActor(OldOwner, Weapon);
+	AddDependentActor(NewOwner, Weapon);
+}
+
+int32 UPCReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PCRepGraphReplicate);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	UpdateOwnerRelevantActors();
+
+	if (++FramesSinceViewPriorityUpdate >= ViewPriorityUpdateFrames)
+	{
+		FramesSinceViewPriorityUpdate = 0;
+		UpdateViewPriorities(DeltaSeconds);
+	}
+
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	TotalReplicateSeconds += ElapsedSeconds;
+	PeakReplicateSeconds = FMath::Max(PeakReplicateSeconds, ElapsedSeconds);
+	ReplicateFrames++;
+
+	return Result;
+}
+
+/*
+	UpdateViewPriorities
+	======================================================================
+	The graph doesn't ask actors for their net priority, so the view
+	based priority is applied by stretching each connection's
+	replication period of a character. A character the connection cares
+	about less than normal (far away, behind the viewer, low bandwidth)
+	replicates every N-th time it would otherwise, N up to
+	MaxViewPeriodMultiplier. The global period the character's activity
+	sets is never shortened. Connections that haven't seen a character
+	yet take the global period until the next update.
+	======================================================================
+*/
+void UPCReplicationGraph::UpdateViewPriorities(float DeltaSeconds)
+{
+	for (UNetReplicationGraphConnection* ConnectionManager : Connections)
+	{
+		UNetConnection* NetConnection = ConnectionManager ? ConnectionManager->NetConnection : nullptr;
+		if (!NetConnection || !NetConnection->ViewTarget)
+		{
+			continue;
+		}
+
+		const FNetViewer Viewer(NetConnection, DeltaSeconds);
+		const bool bLowBandwidth = NetConnection->CurrentNetSpeed <= LowBandwidthNetSpeed;
+
+		for (const TWeakObjectPtr<APCCharacter>& WeakCharacter : ViewPrioritizedCharacters)
+		{
+			APCCharacter* Character = WeakCharacter.Get();
+			FConnectionReplicationActorInfo* ConnectionInfo = Character ? ConnectionManager->ActorInfoMap.Find(Character) : nullptr;
+			const FGlobalActorReplicationInfo* GlobalInfo = Character ? GlobalActorReplicationInfoMap.Find(Character) : nullptr;
+			if (!ConnectionInfo || !GlobalInfo)
+			{
+				continue;
+			}
+
+			uint32 Multiplier = 1;
+
+			// The viewer's own pawn always gets the full rate
+			if (Character != Viewer.ViewTarget && Character->GetController() != Viewer.InViewer)
+			{
+				const float Scale = Character->GetNetViewScale(Viewer.ViewLocation, Viewer.ViewDir, bLowBandwidth);
+				Multiplier = (uint32)FMath::Clamp(FMath::RoundToInt(1.0f / FMath::Max(Scale, KINDA_SMALL_NUMBER)), 1, MaxViewPeriodMultiplier);
+			}
+
+			ConnectionInfo->ReplicationPeriodFrame = GlobalInfo->Settings.ReplicationPeriodFrame * Multiplier;
+		}
+	}
+}
+
+void UPCReplicationGraph::LogReplicationStats()
+{
+	UE_LOG(LogTemp, Log, TEXT("RepGraph: Connections %d, Frames %d, Avg %.3f ms/frame, Peak %.3f ms"),
+		Connections.Num(), ReplicateFrames,
+		ReplicateFrames > 0 ? TotalReplicateSeconds * 1000.0 / ReplicateFrames : 0.0,
+		PeakReplicateSeconds * 1000.0);
+
+	TotalReplicateSeconds = 0.0;
+	PeakReplicateSeconds = 0.0;
+	ReplicateFrames = 0;
+}
@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCSignificanceManager.h"
+#include "ProjectCharlie.h"
+#include "PCWeaponBase.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_ProjectCharlie);
+
+APCSignificanceManager::APCSignificanceManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = true;
+
+	UpdateInterval = 0.25f;
+	FullDistance = 2500.0f;
+	ReducedDistance = 6000.0f;
+	AudibleDistance = 15000.0f;
+}
+
+void APCSignificanceManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetActorTickInterval(UpdateInterval);
+
+	// Weapons always report SKIP on a dedicated server, nothing to score
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void APCSignificanceManager::RegisterWeapon(APCWeaponBase* Weapon)
+{
+	if (Weapon)
+	{
+		Weapons.AddUnique(Weapon);
+	}
+}
+
+void APCSignificanceManager::UnregisterWeapon(APCWeaponBase* Weapon)
+{
+	Weapons.RemoveSwap(Weapon);
+}
+
+ESignificanceTier APCSignificanceManager::ScoreWeapon(const APCWeaponBase* Weapon, const FVector& ViewLocation) const
+{
+	const APawn* OwnerPawn = Cast<APawn>(Weapon->GetOwner());
+	if (OwnerPawn && OwnerPawn->IsLocallyControlled() && OwnerPawn->IsPlayerControlled())
+	{
+		return ESignificanceTier::FULL;
+	}
+
+	const float DistanceSquared = FVector::DistSquared(ViewLocation, Weapon->GetActorLocation());
+	if (DistanceSquared > FMath::Square(AudibleDistance))
+	{
+		return ESignificanceTier::SKIP;
+	}
+
+	const USkeletalMeshComponent* Mesh = Weapon->GetGunMeshComp();
+	const bool bVisible = Mesh && Mesh->WasRecentlyRendered(0.2f);
+	if (!bVisible)
+	{
+		return ESignificanceTier::MINIMAL;
+	}
+
+	if (DistanceSquared < FMath::Square(FullDistance))
+	{
+		return ESignificanceTier::FULL;
+	}
+
+	if (DistanceSquared < FMath::Square(ReducedDistance))
+	{
+		return ESignificanceTier::REDUCED;
+	}
+
+	return ESignificanceTier::MINIMAL;
+}
+
+void APCSignificanceManager::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	Super::Tick(DeltaTime);
+
+	APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	if (!PC || !PC->IsLocalController())
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	for (int32 i = Weapons.Num() - 1; i >= 0; i--)
+	{
+		APCWeaponBase* Weapon = Weapons[i].Get();
+		if (!Weapon)
+		{
+			Weapons.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+
+		Weapon->SetSignificanceTier(ScoreWeapon(Weapon, ViewLocation));
+	}
+}
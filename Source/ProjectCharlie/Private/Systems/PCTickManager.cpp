@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCTickManager.h"
+#include "ProjectCharlie.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+// Per-type tick stats ("stat PCTickManager")
+DECLARE_STATS_GROUP(TEXT("PCTickManager"), STATGROUP_PCTickManager, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT(TEXT("Tick Manager"), STAT_TickManager, STATGROUP_PCTickManager);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Managed Object Ticks"), STAT_ManagedObjectTicks, STATGROUP_PCTickManager);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Managed Batches"), STAT_ManagedBatches, STATGROUP_PCTickManager);
+
+//Tick Manager Stats Commands
+static FAutoConsoleCommandWithWorld CmdDumpTickManager(
+	TEXT("PC.TickManager.Stats"),
+	TEXT("Log per-type managed tick counts and time for the current world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (APCTickManager* TickManager = APCWorldManager::Find<APCTickManager>(World))
+		{
+			TickManager->LogTickStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CmdResetTickManager(
+	TEXT("PC.TickManager.ResetStats"),
+	TEXT("Reset the managed tick totals for the current world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (APCTickManager* TickManager = APCWorldManager::Find<APCTickManager>(World))
+		{
+			TickManager->ResetTickStats();
+		}
+	}));
+
+APCTickManager::APCTickManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void APCTickManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Buckets.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FPCTickBucket* APCTickManager::FindBucket(UClass* Class) const
+{
+	const TUniquePtr<FPCTickBucket>* Bucket = Buckets.Find(Class);
+	return Bucket ? Bucket->Get() : nullptr;
+}
+
+void APCTickManager::AddBucket(UClass* Class, FPCTickBucket* Bucket)
+{
+	Bucket->TypeName = Class->GetFName();
+
+	if (const float* Interval = TickIntervals.Find(Bucket->TypeName))
+	{
+		Bucket->Interval = FMath::Max(*Interval, 0.0f);
+	}
+
+#if STATS
+	Bucket->StatId = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_PCTickManager>(Bucket->TypeName.ToString());
+#endif
+
+	Buckets.Add(Class, TUniquePtr<FPCTickBucket>(Bucket));
+}
+
+/*
+	Tick
+	======================================================================
+	Run every bucket that is due as one batch and go to sleep once all
+	buckets are empty. Register calls wake the manager back up.
+	======================================================================
+*/
+void APCTickManager::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TickManager);
+
+	Super::Tick(DeltaTime);
+
+	// Snapshot the buckets, a managed tick may register a type we have not seen yet
+	TArray<FPCTickBucket*, TInlineAllocator<8>> BucketsToTick;
+	for (TPair<UClass*, TUniquePtr<FPCTickBucket>>& Pair : Buckets)
+	{
+		BucketsToTick.Add(Pair.Value.Get());
+	}
+
+	bool bHasWork = false;
+
+	for (FPCTickBucket* BucketPtr : BucketsToTick)
+	{
+		FPCTickBucket& Bucket = *BucketPtr;
+
+		const int32 Count = Bucket.Num();
+		if (Count == 0)
+		{
+			Bucket.TimeSinceTick = 0.0f;
+			continue;
+		}
+
+		Bucket.TimeSinceTick += DeltaTime;
+		if (Bucket.TimeSinceTick < Bucket.Interval)
+		{
+			bHasWork = true;
+			continue;
+		}
+
+		const float BatchDeltaTime = Bucket.TimeSinceTick;
+		Bucket.TimeSinceTick = 0.0f;
+
+		const double StartTime = FPlatformTime::Seconds();
+		{
+			FScopeCycleCounter CycleCounter(Bucket.StatId);
+			Bucket.TickObjects(BatchDeltaTime);
+		}
+		Bucket.TotalSeconds += FPlatformTime::Seconds() - StartTime;
+		Bucket.BatchCount++;
+		Bucket.ObjectTickCount += Count;
+
+		INC_DWORD_STAT(STAT_ManagedBatches);
+		INC_DWORD_STAT_BY(STAT_ManagedObjectTicks, Count);
+
+		bHasWork |= Bucket.Num() > 0;
+	}
+
+	if (!bHasWork)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void APCTickManager::LogTickStats() const
+{
+	for (const TPair<UClass*, TUniquePtr<FPCTickBucket>>& Pair : Buckets)
+	{
+		const FPCTickBucket& Bucket = *Pair.Value;
+		UE_LOG(LogTemp, Log, TEXT("TickManager %s: Registered %d, Interval %.3f, Batches %d, Object Ticks %d, Total %.3f ms, Avg %.4f ms/batch"),
+			*Bucket.TypeName.ToString(), Bucket.Num(), Bucket.Interval, Bucket.BatchCount, Bucket.ObjectTickCount,
+			Bucket.TotalSeconds * 1000.0, Bucket.BatchCount > 0 ? Bucket.TotalSeconds * 1000.0 / Bucket.BatchCount : 0.0);
+	}
+}
+
+void APCTickManager::ResetTickStats()
+{
+	for (TPair<UClass*, TUniquePtr<FPCTickBucket>>& Pair : Buckets)
+	{
+		Pair.Value->BatchCount = 0;
+		Pair.Value->ObjectTickCount = 0;
+		Pair.Value->TotalSeconds = 0.0;
+	}
+}
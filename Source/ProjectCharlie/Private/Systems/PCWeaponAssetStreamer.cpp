@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCWeaponAssetStreamer.h"
+#include "ProjectCharlie.h"
+#include "PCWeaponBase.h"
+#include "Systems/PCEffectsPool.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Streamed Weapon Classes"), STAT_StreamedWeaponClasses, STATGROUP_ProjectCharlie);
+
+//Weapon Asset Stats Command
+static FAutoConsoleCommandWithWorld CmdDumpWeaponAssets(
+	TEXT("PC.WeaponAssets.Stats"),
+	TEXT("Log memory used by streamed weapon assets per weapon family for the current world"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (APCWeaponAssetStreamer* Streamer = APCWorldManager::Find<APCWeaponAssetStreamer>(World))
+		{
+			Streamer->LogAssetStats();
+		}
+	}));
+
+APCWeaponAssetStreamer::APCWeaponAssetStreamer()
+{
+	ReleaseDelay = 30.0f;
+}
+
+void APCWeaponAssetStreamer::BeginPlay()
+{
+	Super::BeginPlay();
+
+	GetWorldTimerManager().SetTimer(TimerHandle_ReleaseUnused, this, &APCWeaponAssetStreamer::ReleaseUnused, FMath::Max(ReleaseDelay * 0.5f, 1.0f), true);
+}
+
+void APCWeaponAssetStreamer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_ReleaseUnused);
+
+	for (TPair<TWeakObjectPtr<UClass>, FEntry>& Pair : Entries)
+	{
+		if (Pair.Value.Handle.IsValid())
+		{
+			Pair.Value.Handle->ReleaseHandle();
+		}
+	}
+	Entries.Empty();
+
+	SET_DWORD_STAT(STAT_StreamedWeaponClasses, 0);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FName APCWeaponAssetStreamer::GetWeaponFamily(const UClass* WeaponClass)
+{
+	// /Game/Weapons/<Family>/...
+	static const FString WeaponsRoot(TEXT("/Game/Weapons/"));
+
+	const FString PackageName = WeaponClass->GetOutermost()->GetName();
+	if (PackageName.StartsWith(WeaponsRoot))
+	{
+		const int32 FamilyEnd = PackageName.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, WeaponsRoot.Len());
+		if (FamilyEnd != INDEX_NONE)
+		{
+			return FName(*PackageName.Mid(WeaponsRoot.Len(), FamilyEnd - WeaponsRoot.Len()));
+		}
+	}
+
+	return FName(TEXT("Other"));
+}
+
+APCWeaponAssetStreamer::FEntry& APCWeaponAssetStreamer::FindOrLoad(UClass* WeaponClass)
+{
+	if (FEntry* Existing = Entries.Find(WeaponClass))
+	{
+		return *Existing;
+	}
+
+	FEntry& Entry = Entries.Add(WeaponClass);
+	Entry.Family = GetWeaponFamily(WeaponClass);
+	Entry.UnusedSince = GetWorld()->TimeSeconds;
+
+	GetDefault<APCWeaponBase>(WeaponClass)->GetStreamedAssets(Entry.Assets, PCShouldPlayCosmetics(this));
+	if (Entry.Assets.Num() != 0)
+	{
+		const FStreamableDelegate OnLoaded = FStreamableDelegate::CreateUObject(this, &APCWeaponAssetStreamer::OnAssetsLoaded, TWeakObjectPtr<UClass>(WeaponClass));
+		Entry.Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Entry.Assets, OnLoaded);
+	}
+
+	SET_DWORD_STAT(STAT_StreamedWeaponClasses, Entries.Num());
+
+	return Entry;
+}
+
+void APCWeaponAssetStreamer::PrefetchAssets(UClass* WeaponClass)
+{
+	if (WeaponClass && WeaponClass->IsChildOf(APCWeaponBase::StaticClass()))
+	{
+		FindOrLoad(WeaponClass);
+	}
+}
+
+void APCWeaponAssetStreamer::AcquireAssets(UClass* WeaponClass)
+{
+	if (WeaponClass && WeaponClass->IsChildOf(APCWeaponBase::StaticClass()))
+	{
+		FindOrLoad(WeaponClass).RefCount++;
+	}
+}
+
+void APCWeaponAssetStreamer::ReleaseAssets(UClass* WeaponClass)
+{
+	FEntry* Entry = Entries.Find(WeaponClass);
+	if (Entry && Entry->RefCount > 0 && --Entry->RefCount == 0)
+	{
+		Entry->UnusedSince = GetWorld()->TimeSeconds;
+	}
+}
+
+void APCWeaponAssetStreamer::OnAssetsLoaded(TWeakObjectPtr<UClass> WeaponClass)
+{
+#if PC_WITH_COSMETICS
+	// Pre-create the particle components for the weapon's effects now that they exist
+	APCEffectsPool* EffectsPool = PCShouldPlayCosmetics(this) ? APCWorldManager::Get<APCEffectsPool>(this) : nullptr;
+	if (EffectsPool && WeaponClass.IsValid())
+	{
+		TArray<UParticleSystem*> Effects;
+		GetDefault<APCWeaponBase>(WeaponClass.Get())->GetStreamedEffects(Effects);
+		for (UParticleSystem* Effect : Effects)
+		{
+			EffectsPool->WarmUp(Effect);
+		}
+	}
+#endif
+}
+
+/*
+	ReleaseUnused
+	======================================================================
+	Releases the handles of weapon classes nobody has used for
+	ReleaseDelay seconds. The effects pool holds on to the templates it
+	was warmed up with, so the released classes' effects are dropped
+	from it too, unless a class still loaded uses the same effect.
+	======================================================================
+*/
+void APCWeaponAssetStreamer::ReleaseUnused()
+{
+	const float Now = GetWorld()->TimeSeconds;
+
+	TArray<UParticleSystem*> ReleasedEffects;
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		FEntry& Entry = It.Value();
+		if (!It.Key().IsValid() || (Entry.RefCount == 0 && Now - Entry.UnusedSince >= ReleaseDelay))
+		{
+			if (It.Key().IsValid())
+			{
+				GetDefault<APCWeaponBase>(It.Key().Get())->GetStreamedEffects(ReleasedEffects);
+			}
+
+			if (Entry.Handle.IsValid())
+			{
+				Entry.Handle->ReleaseHandle();
+			}
+			It.RemoveCurrent();
+		}
+	}
+
+	APCEffectsPool* EffectsPool = APCWorldManager::Find<APCEffectsPool>(this);
+	if (EffectsPool && ReleasedEffects.Num() > 0)
+	{
+		TArray<UParticleSystem*> KeptEffects;
+		for (const TPair<TWeakObjectPtr<UClass>, FEntry>& Pair : Entries)
+		{
+			if (Pair.Key.IsValid())
+			{
+				GetDefault<APCWeaponBase>(Pair.Key.Get())->GetStreamedEffects(KeptEffects);
+			}
+		}
+
+		for (UParticleSystem* Effect : ReleasedEffects)
+		{
+			if (!KeptEffects.Contains(Effect))
+			{
+				EffectsPool->ReleaseTemplate(Effect);
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_StreamedWeaponClasses, Entries.Num());
+}
+
+void APCWeaponAssetStreamer::GetFamilyStats(TArray<FPCWeaponFamilyStats>& OutStats) const
+{
+	OutStats.Reset();
+
+	for (const TPair<TWeakObjectPtr<UClass>, FEntry>& Pair : Entries)
+	{
+		const FEntry& Entry = Pair.Value;
+
+		FPCWeaponFamilyStats* Stats = OutStats.FindByPredicate([&Entry](const FPCWeaponFamilyStats& Existing) { return Existing.Family == Entry.Family; });
+		if (!Stats)
+		{
+			Stats = &OutStats.AddDefaulted_GetRef();
+			Stats->Family = Entry.Family;
+		}
+
+		Stats->NumWeaponClasses++;
+		Stats->NumAssets += Entry.Assets.Num();
+
+		// Assets shared between classes of a family are counted once per class
+		for (const FSoftObjectPath& Asset : Entry.Assets)
+		{
+			if (UObject* Loaded = Asset.ResolveObject())
+			{
+				Stats->NumLoadedAssets++;
+				Stats->ResourceSizeBytes += Loaded->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			}
+		}
+	}
+}
+
+void APCWeaponAssetStreamer::LogAssetStats() const
+{
+	TArray<FPCWeaponFamilyStats> FamilyStats;
+	GetFamilyStats(FamilyStats);
+
+	for (const FPCWeaponFamilyStats& Stats : FamilyStats)
+	{
+		UE_LOG(LogTemp, Log, TEXT("WeaponAssets %s: Classes %d, Assets %d/%d loaded, %.2f MB"),
+			*Stats.Family.ToString(), Stats.NumWeaponClasses, Stats.NumLoadedAssets, Stats.NumAssets, Stats.ResourceSizeBytes / (1024.0 * 1024.0));
+	}
+}
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCWeaponAudioPool.h"
+#include "ProjectCharlie.h"
+#include "Components/AudioComponent.h"
+#include "Sound/SoundBase.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Voices Stolen"), STAT_WeaponVoicesStolen, STATGROUP_ProjectCharlie);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Sounds Dropped"), STAT_WeaponSoundsDropped, STATGROUP_ProjectCharlie);
+
+APCWeaponAudioPool::APCWeaponAudioPool()
+{
+	VoiceBudget = 24;
+	PriorityHalfDistance = 2500.0f;
+}
+
+void APCWeaponAudioPool::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// No audio device on a dedicated server, keep the pool empty
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	Voices.Reserve(VoiceBudget);
+	VoicePriorities.Reserve(VoiceBudget);
+
+	for (int32 i = 0; i < VoiceBudget; i++)
+	{
+		UAudioComponent* Voice = NewObject<UAudioComponent>(this);
+		Voice->bAutoActivate = false;
+		Voice->bAutoDestroy = false;
+		Voice->RegisterComponent();
+		Voice->OnAudioFinishedNative.AddUObject(this, &APCWeaponAudioPool::HandleVoiceFinished);
+
+		Voices.Add(Voice);
+		VoicePriorities.Add(0.0f);
+	}
+}
+
+bool APCWeaponAudioPool::GetListenerLocation(FVector& OutLocation) const
+{
+	APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	if (PC && PC->IsLocalController())
+	{
+		FVector FrontDir;
+		FVector RightDir;
+		PC->GetAudioListenerPosition(OutLocation, FrontDir, RightDir);
+		return true;
+	}
+
+	return false;
+}
+
+float APCWeaponAudioPool::GetEffectivePriority(float Priority, const FVector& Location, const FVector& ListenerLocation) const
+{
+	const float Distance = FVector::Dist(Location, ListenerLocation);
+	return Priority / (1.0f + Distance / FMath::Max(PriorityHalfDistance, 1.0f));
+}
+
+bool APCWeaponAudioPool::PlaySoundAttached(USoundBase* Sound, USceneComponent* AttachToComponent, FName SocketName, float Priority)
+{
+	if (!Sound || !AttachToComponent || Voices.Num() == 0)
+	{
+		return false;
+	}
+
+	// Prefer an idle voice
+	int32 VoiceIndex = Voices.IndexOfByPredicate([](const UAudioComponent* Voice) { return !Voice->IsPlaying(); });
+
+	// Otherwise steal the least important one, if it ranks below the new sound
+	if (VoiceIndex == INDEX_NONE)
+	{
+		FVector ListenerLocation = FVector::ZeroVector;
+		const bool bHasListener = GetListenerLocation(ListenerLocation);
+
+		const FVector SoundLocation = AttachToComponent->GetSocketLocation(SocketName);
+		float LowestPriority = bHasListener ? GetEffectivePriority(Priority, SoundLocation, ListenerLocation) : Priority;
+
+		for (int32 i = 0; i < Voices.Num(); i++)
+		{
+			const float VoicePriority = bHasListener ? GetEffectivePriority(VoicePriorities[i], Voices[i]->GetComponentLocation(), ListenerLocation) : VoicePriorities[i];
+			if (VoicePriority < LowestPriority)
+			{
+				LowestPriority = VoicePriority;
+				VoiceIndex = i;
+			}
+		}
+
+		if (VoiceIndex == INDEX_NONE)
+		{
+			INC_DWORD_STAT(STAT_WeaponSoundsDropped);
+			return false;
+		}
+
+		INC_DWORD_STAT(STAT_WeaponVoicesStolen);
+		Voices[VoiceIndex]->Stop();
+	}
+
+	UAudioComponent* Voice = Voices[VoiceIndex];
+	Voice->AttachToComponent(AttachToComponent, FAttachmentTransformRules::SnapToTargetNotIncludingScale, SocketName);
+	Voice->SetSound(Sound);
+	Voice->Play();
+
+	VoicePriorities[VoiceIndex] = Priority;
+
+	return true;
+}
+
+void APCWeaponAudioPool::HandleVoiceFinished(UAudioComponent* Voice)
+{
+	// Don't keep finished voices attached to weapons that may be destroyed
+	if (Voice && !Voice->IsPlaying())
+	{
+		Voice->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Systems/PCWorldManager.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "UObject/ObjectKey.h"
+
+namespace
+{
+	// World -> (Manager Class -> Manager)
+	TMap<FObjectKey, TMap<FObjectKey, TWeakObjectPtr<APCWorldManager>>> ManagerRegistry;
+}
+
+APCWorldManager::APCWorldManager()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	SetReplicates(false);
+	bHidden = true;
+	bCanBeDamaged = false;
+}
+
+APCWorldManager* APCWorldManager::FindExisting(const UObject* WorldContextObject, UClass* ManagerClass)
+{
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	TMap<FObjectKey, TWeakObjectPtr<APCWorldManager>>* WorldManagers = ManagerRegistry.Find(World);
+	if (!WorldManagers)
+	{
+		return nullptr;
+	}
+
+	TWeakObjectPtr<APCWorldManager>* Manager = WorldManagers->Find(ManagerClass);
+	return Manager ? Manager->Get() : nullptr;
+}
+
+APCWorldManager* APCWorldManager::GetOrCreate(const UObject* WorldContextObject, UClass* ManagerClass)
+{
+	if (APCWorldManager* Existing = FindExisting(WorldContextObject, ManagerClass))
+	{
+		return Existing;
+	}
+
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	if (!World || !World->IsGameWorld() || World->bIsTearingDown)
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	APCWorldManager* Manager = World->SpawnActor<APCWorldManager>(ManagerClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+
+	if (Manager)
+	{
+		ManagerRegistry.FindOrAdd(World).Add(ManagerClass, Manager);
+	}
+
+	return Manager;
+}
+
+void APCWorldManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	if (TMap<FObjectKey, TWeakObjectPtr<APCWorldManager>>* WorldManagers = ManagerRegistry.Find(GetWorld()))
+	{
+		WorldManagers->Remove(GetClass());
+
+		if (WorldManagers->Num() == 0)
+		{
+			ManagerRegistry.Remove(GetWorld());
+		}
+	}
+}
@@ -2,6 +2,19 @@
 
 #include "ProjectCharlie.h"
 #include "Modules/ModuleManager.h"
+#include "GameFramework/Actor.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, ProjectCharlie, "ProjectCharlie" );
- 
\ No newline at end of file
+
+//Cosmetics Stripping Command
+static int32 StripCosmetics = 0;
+FAutoConsoleVariableRef CVARStripCosmetics(TEXT("PC.StripCosmetics"), StripCosmetics, TEXT("Skip all cosmetic weapon/character work as a dedicated server would (for profiling headless load)"), ECVF_Cheat);
+
+bool PCShouldPlayCosmetics(const AActor* Actor)
+{
+#if PC_WITH_COSMETICS
+	return Actor && StripCosmetics == 0 && Actor->GetNetMode() != NM_DedicatedServer;
+#else
+	return false;
+#endif
+}
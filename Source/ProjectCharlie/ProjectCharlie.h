@@ -3,3 +3,19 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+// Stat group for gameplay systems ("stat ProjectCharlie")
+DECLARE_STATS_GROUP(TEXT("ProjectCharlie"), STATGROUP_ProjectCharlie, STATCAT_Advanced);
+
+// Custom collision channels (see [/Script/Engine.CollisionProfile] in DefaultEngine.ini)
+#define COLLISION_BULLET ECC_GameTraceChannel1
+
+// Cosmetic code (audio, particles, camera shake, cosmetic montages, ADS smoothing) is compiled out of server-only builds
+#define PC_WITH_COSMETICS !UE_SERVER
+
+/*
+	Whether Actor should do cosmetic work. False in server builds, on a
+	dedicated server, and when stripping is forced with PC.StripCosmetics.
+*/
+PROJECTCHARLIE_API bool PCShouldPlayCosmetics(const AActor* Actor);
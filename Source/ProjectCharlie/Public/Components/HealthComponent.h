@@ -9,6 +9,9 @@
 // OnHealthChanged
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_SixParams(FOnHealthChangedSignature, UHealthComponent*, HealthComp, float, Health, float, HealthData, const class UDamageType*, DamageType, class AController*, InstigatedBy, AActor*, DamageCauser);
 
+// OnHealthChangedBatch
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FOnHealthChangedBatchSignature, UHealthComponent*, HealthComp, float, Health, float, TotalDamage, const TArray<class AController*>&, Instigators);
+
 UCLASS( ClassGroup=(PC3), meta=(BlueprintSpawnableComponent) )
 class PROJECTCHARLIE_API UHealthComponent : public UActorComponent
 {
@@ -28,11 +31,28 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthComponent") //edit defaults only to change default
 	float DefaultHealth;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "HealthComponent") // Also gather all damage taken in a frame into one OnHealthChangedBatch broadcast
+	bool bBatchDamage;
+
+	// Damage gathered this frame while batching
+	float BatchedDamage;
+
+	UPROPERTY(Transient)
+	TArray<class AController*> BatchedInstigators;
+
+	FTimerHandle TimerHandle_FlushBatchedDamage;
+
 	UFUNCTION()
 	void HandleTakeAnyDamage(AActor* DamagedActor, float Damage, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
 
+	void FlushBatchedDamage();
+
 public:	
 
 	UPROPERTY(BlueprintAssignable, Category = "Events")
-	FOnHealthChangedSignature OnHealthChanged;		
+	FOnHealthChangedSignature OnHealthChanged;
+
+	// Only fires with bBatchDamage set, once per frame damage was taken in, with the frame's total damage and every controller that dealt it
+	UPROPERTY(BlueprintAssignable, Category = "Events")
+	FOnHealthChangedBatchSignature OnHealthChangedBatch;
 };
\ No newline at end of file
@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "PCMagazineBase.h"
+#include "InventoryComponent.generated.h"
+
+class UInventoryComponent;
+struct FInventoryList;
+
+// OnInventoryChanged
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnInventoryChangedSignature, UInventoryComponent*, InventoryComp, TSubclassOf<AActor>, ItemClass, int32, Count);
+
+/*
+	One slot of the inventory. Magazine classes count loose rounds for
+	that magazine type, everything else counts units.
+*/
+USTRUCT()
+struct FInventoryEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<AActor> ItemClass;
+
+	UPROPERTY()
+	int32 Count;
+
+	FInventoryEntry()
+		: Count(0)
+	{
+	}
+
+	void PostReplicatedAdd(const FInventoryList& InArraySerializer);
+	void PostReplicatedChange(const FInventoryList& InArraySerializer);
+	void PreReplicatedRemove(const FInventoryList& InArraySerializer);
+};
+
+/*
+	Slots are only ever appended and emptied slots are kept, so a slot
+	index is a stable item id on the server. Only slots whose count
+	changed are sent.
+*/
+USTRUCT()
+struct FInventoryList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FInventoryEntry> Entries;
+
+	UInventoryComponent* Owner; // Set by the owning component, not copied from its archetype
+
+	FInventoryList()
+		: Owner(nullptr)
+	{
+	}
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryEntry, FInventoryList>(Entries, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryList> : public TStructOpsTypeTraitsBase2<FInventoryList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+USTRUCT(BlueprintType)
+struct FInventoryStartingItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Inventory")
+	TSubclassOf<AActor> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Inventory") // Rounds for magazines, units otherwise
+	int32 Count;
+
+	FInventoryStartingItem()
+		: Count(0)
+	{
+	}
+};
+
+/*
+	Items and ammo carried by a character, stored as one flat array of
+	(class, count) slots with a class to slot index on the side. The
+	server owns the counts and replicates them to the owner as a fast
+	array. Magazine lookups cache the slots that fit each weapon, so
+	finding the best magazine only looks at those, however much else is
+	carried.
+*/
+UCLASS( ClassGroup=(PC3), meta=(BlueprintSpawnableComponent) )
+class PROJECTCHARLIE_API UInventoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UInventoryComponent();
+
+	static const uint16 NoItem = 0xFFFF;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory") // Given to the owner when play begins
+	TArray<FInventoryStartingItem> StartingItems;
+
+	UPROPERTY(BlueprintAssignable, Category = "Events")
+	FOnInventoryChangedSignature OnInventoryChanged;
+
+	// Slot of ItemClass, NoItem if it was never carried
+	uint16 FindItemId(UClass* ItemClass) const;
+
+	int32 GetCountById(uint16 ItemId) const { return Items.Entries.IsValidIndex(ItemId) ? Items.Entries[ItemId].Count : 0; }
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	int32 GetCount(TSubclassOf<AActor> ItemClass) const;
+
+	// Server only. Returns the new count.
+	int32 AddItem(TSubclassOf<AActor> ItemClass, int32 Count);
+
+	// Server only. Removes up to Count and returns how many were removed.
+	int32 RemoveItem(TSubclassOf<AActor> ItemClass, int32 Count);
+
+	// Carried magazine type with the most rounds that fits a weapon taking WeaponMagazineClass, null if none is left
+	TSubclassOf<APCMagazineBase> FindBestMagazine(TSubclassOf<APCMagazineBase> WeaponMagazineClass) const;
+
+	/*
+		Swaps Magazine for the best carried one. On the server the rounds
+		left in the old magazine go back into the ledger and the new one's
+		rounds come out of it, the owning client only predicts the result.
+		Magazine is always left in a state to load into the weapon, false
+		if it ends up without rounds.
+	*/
+	bool ReloadMagazine(TSubclassOf<APCMagazineBase> WeaponMagazineClass, FPCMagazineState& Magazine);
+
+	void OnEntryAdded(const FInventoryEntry& Entry);
+	void OnEntryChanged(const FInventoryEntry& Entry);
+	void OnEntryRemoved();
+
+protected:
+	virtual void BeginPlay() override;
+
+	UPROPERTY(Replicated)
+	FInventoryList Items;
+
+	mutable TMap<UClass*, uint16> ItemIds;
+
+	// Slots that fit each weapon magazine class asked about so far
+	mutable TMap<UClass*, TArray<uint16>> MagazineSlots;
+
+	// Client, a replicated removal reordered the slots
+	mutable bool bItemIdsDirty;
+
+	uint16 AddSlot(UClass* ItemClass);
+	void RebuildItemIds() const;
+};
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LimbHealthComponent.generated.h"
+
+class USkeletalMeshComponent;
+struct FLimbBoneTable;
+
+// OnLimbHealthChanged
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnLimbHealthChangedSignature, ULimbHealthComponent*, LimbHealthComp, int32, LimbIndex, float, LimbHealth);
+
+/*
+	A group of bones that takes damage together. Every bone below one of
+	Bones belongs to the limb too, unless it is below another limb's bone.
+*/
+USTRUCT(BlueprintType)
+struct FLimbDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Limb")
+	FName Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Limb")
+	TArray<FName> Bones;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Limb")
+	float MaxHealth;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Limb") // Scales point damage landing on this limb
+	float DamageMultiplier;
+
+	FLimbDefinition()
+		: MaxHealth(100.0f)
+		, DamageMultiplier(1.0f)
+	{
+	}
+};
+
+/*
+	Per-limb health for a skeletal character. Point damage is routed to a
+	limb by the physics body (or bone) it hit and scaled by that limb's
+	multiplier. The body and bone to limb tables are built once per
+	skeletal mesh and shared by every component using that mesh, so the
+	damage path is two array lookups. Limb health replicates as one byte
+	per limb.
+*/
+UCLASS( ClassGroup=(PC3), meta=(BlueprintSpawnableComponent) )
+class PROJECTCHARLIE_API ULimbHealthComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULimbHealthComponent();
+
+	static const uint8 NoLimb = 0xFF;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "LimbHealth")
+	TArray<FLimbDefinition> Limbs;
+
+	UPROPERTY(BlueprintAssignable, Category = "Events")
+	FOnLimbHealthChangedSignature OnLimbHealthChanged;
+
+	// Server only. Damages the limb Hit landed on and returns the damage scaled by its multiplier.
+	float ApplyPointDamage(const FHitResult& Hit, float Damage);
+
+	// Limb a hit on our mesh landed on, NoLimb if it is not part of any limb
+	uint8 FindLimb(const FHitResult& Hit) const;
+
+	UFUNCTION(BlueprintCallable, Category = "LimbHealth")
+	float GetLimbHealth(int32 LimbIndex) const;
+
+	UFUNCTION(BlueprintCallable, Category = "LimbHealth")
+	int32 GetLimbIndex(FName LimbName) const;
+
+protected:
+	virtual void BeginPlay() override;
+
+	// Health of every limb quantized to 0-255 of its MaxHealth
+	UPROPERTY(ReplicatedUsing = OnRep_LimbHealth)
+	TArray<uint8> LimbHealth;
+
+	TArray<uint8> PreviousLimbHealth; // Client, to tell which limbs changed in OnRep
+
+	TArray<float> LimbHealthValues; // Server, unquantized
+
+	UPROPERTY()
+	USkeletalMeshComponent* MeshComp;
+
+	TSharedPtr<const FLimbBoneTable> BoneTable;
+
+	UFUNCTION()
+	void OnRep_LimbHealth();
+
+	void BuildBoneTable();
+};
@@ -7,10 +7,57 @@
 #include "PCProjectileBase.h"
 #include "PCMagazineBase.generated.h"
 
-class UStaticMeshComponent;
 class UStaticMesh;
+class APCMagazineBase;
+
+/*
+	The magazine loaded in a weapon. Plain data owned by the weapon, the
+	magazine class only supplies the defaults.
+*/
+USTRUCT(BlueprintType)
+struct FPCMagazineState
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Magazine")
+	TSubclassOf<APCMagazineBase> MagazineClass;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Magazine") // The projectile class that this magazine contains
+	TSubclassOf<APCProjectileBase> ProjectileClass;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Magazine") // Maximum magazine capacity
+	int32 MaxCapacity;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Magazine") // The number of rounds left in the magazine
+	int32 RoundsRemaining;
+
+	FPCMagazineState()
+		: MaxCapacity(0)
+		, RoundsRemaining(0)
+	{
+	}
+
+	// A magazine of the given class as loaded in a newly spawned weapon
+	explicit FPCMagazineState(TSubclassOf<APCMagazineBase> InMagazineClass);
+
+	bool IsValid() const { return MagazineClass != nullptr; }
+	bool IsEmpty() const { return RoundsRemaining <= 0; }
+
+	void Empty() { RoundsRemaining = 0; }
+	void Refill() { RoundsRemaining = MaxCapacity; }
+	void UnloadOneRound() { RoundsRemaining = FMath::Max(RoundsRemaining - 1, 0); }
+	void LoadOneRound() { RoundsRemaining = FMath::Min(RoundsRemaining + 1, MaxCapacity); }
+
+	// Class defaults describing the magazine's look, null without a class
+	const APCMagazineBase* GetDefaults() const;
+};
 
-UCLASS()
+/*
+	Magazine type. Never spawned: weapons copy its capacity and projectile
+	into an FPCMagazineState and show its meshes on a component of their
+	own while the weapon is visible.
+*/
+UCLASS(Abstract, Blueprintable)
 class PROJECTCHARLIE_API APCMagazineBase : public AActor
 {
 	GENERATED_BODY()
@@ -21,11 +68,6 @@ public:
 
 protected:
 
-	virtual void BeginPlay() override;
-
-	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Components") // The static mesh component to display the magazine
-	UStaticMeshComponent* MeshComp;
-
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Magazine") // The mesh to show when the magazine is empty
 	UStaticMesh* EmptyMesh;
 
@@ -49,34 +91,17 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Magazine") // Maximum magazine capacity
 	int MaxCapacity;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Magazine") // The number of rounds left in the magazine
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Magazine") // The number of rounds loaded in a weapon's first magazine
 	int RoundsRemaining;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Magazine") // The projectile class that this magazine can contain
 	TSubclassOf<APCProjectileBase> ProjectileClass;
 
+	// Mesh for a magazine with or without rounds left, falls back to the other one if unset
+	UStaticMesh* GetMesh(bool bEmpty) const;
 
-	UStaticMeshComponent* GetMagazineMeshComp();
-
-	void ShowEmptyMesh();
-
-	void ShowFullMesh();
-
-	FVector GetGunSocketOffsetLocation();
-	FVector GetHandSocketOffsetLocation();
-	FRotator GetGunSocketOffsetRotation();
-	FRotator GetHandSocketOffsetRotation();
-
-	void DoGunOffset();
-	void DoHandOffset();
-
-	void Empty();
-
-	void Refill();
-
-	void UnloadOneRound();
-
-	void LoadOneRound();
-
-	bool IsEmpty();
+	FVector GetGunSocketOffsetLocation() const;
+	FVector GetHandSocketOffsetLocation() const;
+	FRotator GetGunSocketOffsetRotation() const;
+	FRotator GetHandSocketOffsetRotation() const;
 };
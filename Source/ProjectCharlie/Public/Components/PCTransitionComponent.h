@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PCTransitionComponent.generated.h"
+
+class UCurveFloat;
+
+/*
+	A running transition. Apply is called with the eased alpha (0 to 1) every
+	tick until Duration has passed, then OnFinished is called once.
+*/
+struct FPCTransition
+{
+	FName Name;
+
+	float Duration;
+
+	float Elapsed;
+
+	TWeakObjectPtr<UCurveFloat> Curve; // Optional easing curve over 0-1, ease out if not set
+
+	TFunction<void(float)> Apply;
+
+	TFunction<void()> OnFinished;
+};
+
+/*
+	Drives short, event-driven blends (ADS, lean, camera moves) for its owner.
+	A transition is started on a state change and advanced by the tick
+	manager only while it runs. The component drops out of the tick manager
+	as soon as nothing is left to blend.
+	Starting a transition with the same name as a running one replaces it, so
+	callers should capture their start values from the current state.
+*/
+UCLASS( ClassGroup=(PC3), meta=(BlueprintSpawnableComponent) )
+class PROJECTCHARLIE_API UPCTransitionComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:	
+	UPCTransitionComponent();
+
+	// Exponent of the default ease out used when a transition has no curve
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Transition")
+	float DefaultEaseExponent;
+
+	void StartTransition(FName Name, float Duration, UCurveFloat* Curve, TFunction<void(float)> Apply, TFunction<void()> OnFinished = TFunction<void()>());
+
+	// Stop a running transition. If bFinish is set it jumps to the end and calls OnFinished
+	void StopTransition(FName Name, bool bFinish);
+
+	UFUNCTION(BlueprintCallable, Category = "Transition")
+	bool IsTransitionActive(FName Name) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Transition")
+	bool HasActiveTransitions() const;
+
+	// Called by the tick manager while any transition is running
+	void ManagedTick(float DeltaTime);
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	TArray<FPCTransition> Transitions;
+
+	bool bRegisteredTick;
+
+	void SetManagedTickEnabled(bool bEnabled);
+
+	float EvaluateAlpha(const FPCTransition& Transition) const;
+};
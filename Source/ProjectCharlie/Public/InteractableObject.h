@@ -21,14 +21,13 @@ UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Components")
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 public:	
 	// Sets default values for this actor's properties
 	AInteractableObject();
 
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	/** IInteractable interface function */
 	bool OnInteract();
 	virtual bool OnInteract_Implementation() override;
@@ -6,7 +6,179 @@
 #include "GameFramework/Character.h"
 #include "PCCharacter.generated.h"
 
+class APCCharacter;
 class APCWeaponBase;
+class UCurveFloat;
+class UPCTransitionComponent;
+class ULimbHealthComponent;
+class UInventoryComponent;
+enum class EPCLoadoutSlot : uint8;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnInteractFocusChangedSignature, APCCharacter*, Character, AActor*, FocusedActor);
+
+/*
+	One-shot cosmetics remote machines should replay for a character.
+	Lasting state such as the equipped weapon goes in FPCCharacterNetState.
+*/
+enum class EPCCharacterEvent : uint8
+{
+	NONE,
+	RELOAD,
+	FIRE
+};
+
+struct FPCCharacterEventEntry
+{
+	EPCCharacterEvent Type = EPCCharacterEvent::NONE;
+
+	uint8 Count = 0; // Shots in this batch for FIRE
+};
+
+/*
+	Ring buffer of the character's most recent events, replicated as state
+	with the pawn instead of as RPCs. Event N lives in slot N % Capacity. A
+	receiver replays everything between the last sequence it saw and
+	NextSequence, and if it missed more than Capacity events (or just became
+	relevant) it skips them instead of replaying stale cosmetics.
+*/
+USTRUCT()
+struct FPCCharacterEventStream
+{
+	GENERATED_BODY()
+
+	static const int32 Capacity = 8;
+
+	static const uint8 MaxFireCount = 31; // Fits in the 5 bits a FIRE count is sent with
+
+	uint16 NextSequence = 0; // Sequence the next pushed event will get
+
+	FPCCharacterEventEntry Events[Capacity];
+
+	void Push(EPCCharacterEvent Type, uint8 Count = 1);
+
+	const FPCCharacterEventEntry& Get(uint16 Sequence) const { return Events[Sequence % Capacity]; }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	// Slots only ever change together with NextSequence
+	bool operator==(const FPCCharacterEventStream& Other) const { return NextSequence == Other.NextSequence; }
+};
+
+/*
+	One shot the owning client already fired locally, sent to the server
+	to be fired again authoritatively.
+*/
+USTRUCT()
+struct FPCShotRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint16 Sequence;
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	UPROPERTY()
+	float ShotTime; // Server world time as seen by the shooter when the shot was fired
+
+	FPCShotRecord()
+		: Sequence(0)
+		, ShotTime(0.0f)
+	{
+	}
+};
+
+/*
+	A hit on another character, reported by the shooting client for the
+	server to validate with lag compensation.
+*/
+USTRUCT()
+struct FPCReportedHit
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class APCCharacter* HitCharacter;
+
+	UPROPERTY()
+	FVector_NetQuantize ShotStart;
+
+	UPROPERTY()
+	FVector_NetQuantize ImpactPoint;
+
+	UPROPERTY()
+	float ShotTime; // Server world time as seen by the shooter when the hit happened
+
+	UPROPERTY()
+	uint16 ShotSequence; // Shot that caused the hit, it must have been accepted by the server
+
+	FPCReportedHit()
+		: HitCharacter(nullptr)
+		, ShotTime(0.0f)
+		, ShotSequence(0)
+	{
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FPCCharacterEventStream> : public TStructOpsTypeTraitsBase2<FPCCharacterEventStream>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
+
+/*
+	Replicated movement/stance/equip state. Flags go over the wire as bits and the
+	lean/peak targets as one byte each, only when non-zero. Receivers start
+	their own blends from it, nothing per-frame is replicated.
+*/
+USTRUCT()
+struct FPCCharacterNetState
+{
+	GENERATED_BODY()
+
+	FPCCharacterNetState();
+
+	bool bIsSprinting;
+
+	bool bIsAiming;
+
+	bool bIsFirstPerson;
+
+	bool bIsWeaponEquipped;
+
+	int8 Lean; // Lean target, -127 (full left) to 127 (full right)
+
+	uint8 Peak; // Peak target, 0 to 255 (full)
+
+	void SetLean(float Alpha);
+	float GetLean() const;
+
+	void SetPeak(float Alpha);
+	float GetPeak() const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FPCCharacterNetState& Other) const;
+	bool operator!=(const FPCCharacterNetState& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FPCCharacterNetState> : public TStructOpsTypeTraitsBase2<FPCCharacterNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
 
 UCLASS()
 class PROJECTCHARLIE_API APCCharacter : public ACharacter
@@ -18,6 +190,19 @@ public:
 	// Sets default values for this character's properties
 	APCCharacter();
 
+	//======================================================================
+	// Components
+	//======================================================================
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	UPCTransitionComponent* TransitionComp; // Blends ADS, lean and peak on state changes
+
+	UPROPERTY(Transient)
+	ULimbHealthComponent* LimbHealthComp; // Optional, added in Blueprint. Scales point damage per limb.
+
+	UPROPERTY(Transient)
+	UInventoryComponent* InventoryComp; // Optional, added in Blueprint. Reloads draw from its ammo, without one they are free.
+
 	//======================================================================
 	// Public Variables
 	//======================================================================
@@ -48,7 +233,7 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Movement")
     float AimWalkSpeed;
 
-	UPROPERTY(Replicated, VisibleAnywhere, BlueprintReadWrite, Category = "Movement")
+	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Movement")
 	bool bIsSprinting;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Movement")
@@ -72,12 +257,66 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Movement")
 	float MaxPeak;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Movement")
+	float LeanTime; // Seconds to blend into or out of a lean/peak
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Movement")
+	UCurveFloat* LeanCurve; // Optional lean/peak easing, ease out if not set
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement")
 	float ForwardAxisValue;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement")
 	float RightAxisValue;
 
+	/*
+		Network Variables
+		----------------------------------------------------------------
+	*/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Network")
+	float ActiveNetUpdateFrequency; // Update rate while sprinting, aiming, firing or taking damage
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Network")
+	float MovingNetUpdateFrequency; // Update rate while just moving around
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Network")
+	float IdleNetUpdateFrequency; // Floor the update rate decays to while idle
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Network")
+	float NetActivityHoldTime; // Seconds to stay at the active rate after the last burst of activity
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Network")
+	float NetUpdateDecayTime; // Seconds to decay from the active rate down to the idle rate
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Network")
+	float NetPriorityFullDistance; // Viewers closer than this get full priority for this character
+
+	float LastNetActivityTime;
+
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FPCCharacterNetState NetState; // Sprint/aim/lean/peak/view/equip state for everyone but the owner
+
+	UPROPERTY(ReplicatedUsing = OnRep_EventStream)
+	FPCCharacterEventStream EventStream; // Recent reload/fire events for everyone but the owner
+
+	uint16 LastEventSequence; // Receiving side, next sequence we have not replayed yet
+
+	bool bEventStreamSynced;
+
+	uint8 PendingFireShots; // Server, shots fired this frame, sent as one FIRE event
+
+	static const int32 MaxShotsPerBatch = 32;
+
+	TArray<FPCShotRecord> PendingShots; // Owning client, predicted shots fired this frame, sent as one batch
+
+	FTimerHandle TimerHandle_FlushFireEvents;
+
+	static const int32 MaxReportedHitsPerBatch = 32;
+
+	TArray<FPCReportedHit> PendingReportedHits; // Hits on other characters waiting to be sent to the server
+
+	FTimerHandle TimerHandle_FlushReportedHits;
+
 	/*
 		Weapon Variables
 		----------------------------------------------------------------
@@ -96,7 +335,7 @@ public:
 
 	FTimerHandle TimerHandle_EquipWeapon;
 
-	UPROPERTY(Replicated, VisibleAnywhere, BlueprintReadWrite, Category = "Weapon")
+	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Weapon")
 	bool bIsAiming;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Weapon")
@@ -104,18 +343,23 @@ public:
 
 	bool bDoingSmoothStopAimWeapon;
 
-	FTimerHandle TimerHandle_ADS;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon")
+	float AimInTime; // Seconds to bring the weapon up to the sights
 
-	FTimerHandle TimerHandle_StopADS;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon")
+	float AimOutTime; // Seconds to bring the weapon back to the hip
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
-	TSubclassOf<APCWeaponBase> PrimaryWeaponClass;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon")
+	UCurveFloat* AimCurve; // Optional ADS easing, ease out if not set
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon") // Loaded and spawned by APCLoadoutSpawner after BeginPlay
+	TSoftClassPtr<APCWeaponBase> PrimaryWeaponClass;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
 	APCWeaponBase* PrimaryWeapon;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
-	TSubclassOf<APCWeaponBase> SecondaryWeaponClass;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon") // Loaded and spawned by APCLoadoutSpawner after BeginPlay
+	TSoftClassPtr<APCWeaponBase> SecondaryWeaponClass;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
 	APCWeaponBase* SecondaryWeapon;
@@ -146,6 +390,18 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Interaction")
 	float InteractDistance;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Interaction")
+	float InteractConeAngle; // Half angle in degrees around the view an interactable can be focused in
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Interaction")
+	bool bConfirmInteractTrace; // Trace to the focused interactable on use so it can't be used through walls
+
+	// Called when the interactable the character would use changes, for interaction prompts
+	UPROPERTY(BlueprintAssignable, Category = "Interaction")
+	FOnInteractFocusChangedSignature OnInteractFocusChanged;
+
+	TWeakObjectPtr<AActor> FocusedInteractable;
+
 	UAnimInstance* AnimInstance; // Used to pass to other things such as the weapon for recoil animation
 
 protected:
@@ -160,6 +416,55 @@ protected:
 	*/
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/*
+		Network Functions
+		----------------------------------------------------------------
+	*/
+	// Raise the update rate right away (server only), it decays again once things calm down
+	void NotifyNetActivity();
+
+	void SetAdaptiveNetUpdateFrequency(float NewFrequency);
+
+	// Gather the local state and send it on if it changed (to the server from the owner, to everyone else from the server)
+	void UpdateNetState();
+
+	virtual FPCCharacterNetState BuildNetState();
+
+	// Take on state that came over the network, starting the same blends the owner did
+	virtual void ApplyNetState(const FPCCharacterNetState& NewState, const FPCCharacterNetState& OldState);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSetNetState(FPCCharacterNetState NewState);
+
+	UFUNCTION()
+	void OnRep_NetState(FPCCharacterNetState OldState);
+
+	// Server only, record an event for remote machines to replay
+	void PushCharacterEvent(EPCCharacterEvent Type, uint8 Count = 1);
+
+	void HandleCharacterEvent(const FPCCharacterEventEntry& Event);
+
+	UFUNCTION()
+	void OnRep_EventStream();
+
+	void FlushFireEvents();
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFireShots(const TArray<FPCShotRecord>& Shots);
+
+	UFUNCTION(Client, Unreliable, WithValidation)
+	void ClientAckShots(uint16 AckedSequence, const TArray<uint16>& RejectedSequences, int32 RoundsRemaining);
+
+	void FlushReportedHits();
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerReportHits(const TArray<FPCReportedHit>& Hits);
+
+	UFUNCTION()
+	void HandleTakeAnyDamageNetActivity(AActor* DamagedActor, float Damage, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
+
 	/*
 		Movement/Rotation Functions
 		----------------------------------------------------------------
@@ -188,6 +493,10 @@ protected:
 	UFUNCTION(BlueprintCallable)
 	float GetPeakAmount();
 
+	void StartLeanTransition(float TargetLean);
+
+	void StartPeakTransition(float TargetPeak);
+
 	/*
 		Weapon Functions
 		----------------------------------------------------------------
@@ -202,6 +511,8 @@ protected:
 
 	virtual void PostStopSmoothAim();
 
+	void StartWeaponAimTransition(bool bAim);
+
 	UFUNCTION(BlueprintCallable)
 	virtual void ToggleEquipWeapon();
 
@@ -219,13 +530,11 @@ protected:
 	UFUNCTION(BlueprintCallable)
 	virtual void PutCurrentWeaponInHolster();
 
-	virtual void LocalToggleEquipWeapon();
+	// Equip or holster the primary weapon, does nothing if already in that state
+	virtual void SetWeaponEquipped(bool bEquip);
 
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerToggleEquipWeapon();
-
-	UFUNCTION(NetMulticast, Reliable, WithValidation)
-	void MulticastToggleEquipWeapon();
+	void ServerSetWeaponEquipped(bool bEquip);
 
 	UFUNCTION(BlueprintCallable)
 	virtual void ChangeFiremode();
@@ -239,6 +548,11 @@ protected:
 	UFUNCTION(BlueprintCallable)
 	virtual void BeginReload();
 
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerBeginReload();
+
+	void PlayReloadAnimation();
+
 	UFUNCTION(BlueprintCallable)
 	virtual void TakeMagazineInHands();
 
@@ -273,11 +587,37 @@ protected:
 	*/
 	virtual void Interact();
 
+	// Where the character looks from and towards when picking an interactable
+	virtual void GetInteractView(FVector& OutLocation, FVector& OutDirection) const;
+
+	// Look for the interactable in front of the character, broadcasts OnInteractFocusChanged if it changed
+	void UpdateInteractFocus();
+
 public:
 
 	//======================================================================
 	// Public Functions
 	//======================================================================
 
-	virtual void Tick(float DeltaTime) override;
+	// Called by the tick manager on the server to adapt the net update rate
+	void ManagedTick(float DeltaTime);
+
+	// Called by the current weapon for every shot, batched into one FIRE event (server) or one shot batch (owning client) per frame
+	void NotifyWeaponFired(const FPCShotRecord& Shot);
+
+	// Client only, send a hit on another character to the server for validation (batched per frame)
+	void ReportHit(APCCharacter* HitCharacter, const FVector& ShotStart, const FVector& ImpactPoint, uint16 ShotSequence);
+
+	UFUNCTION(BlueprintCallable, Category = "Interaction")
+	AActor* GetFocusedInteractable() const;
+
+	// Called by APCLoadoutSpawner once a weapon of our loadout exists
+	void OnLoadoutWeaponSpawned(EPCLoadoutSlot Slot, APCWeaponBase* Weapon);
+
+	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
+
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, class AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
+	// How much a viewer cares about this character, by distance, view direction and recent activity (1 = normal)
+	float GetNetViewScale(const FVector& ViewPos, const FVector& ViewDir, bool bLowBandwidth) const;
 };
@@ -75,7 +75,10 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "View")
 	float CameraBoomAimLength;
 
-	UPROPERTY(Replicated, EditDefaultsOnly, BlueprintReadWrite, Category = "View")
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "View")
+	float ThirdPersonAimTime; // Seconds to move the follow camera into or out of its aim position
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "View")
 	bool bIsFirstPerson;
 
 	/*
@@ -88,6 +91,11 @@ public:
 		Other Variables
 		----------------------------------------------------------------
 	*/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Interaction")
+	float InteractFocusInterval; // Seconds between interact focus updates for prompts
+
+	FTimerHandle TimerHandle_InteractFocus;
+
 	UPROPERTY(EditDefaultsOnly, Category = "TEMP")
 	TSubclassOf<AActor> FireEffectClass;
 
@@ -156,6 +164,14 @@ protected:
 	UFUNCTION(BlueprintCallable)
 	void SetThirdPerson();
 
+	/*
+		Network Functions
+		----------------------------------------------------------------
+	*/
+	virtual FPCCharacterNetState BuildNetState() override;
+
+	virtual void ApplyNetState(const FPCCharacterNetState& NewState, const FPCCharacterNetState& OldState) override;
+
 	/*
 		Weapon Functions
 		----------------------------------------------------------------
@@ -168,11 +184,15 @@ protected:
 
 	virtual void PostSmoothAim() override;
 
+	void StartFirstPersonCameraTransition(bool bAim);
+
+	void StartThirdPersonCameraTransition(bool bAim);
+
 	/*
 		Other Functions
 		----------------------------------------------------------------
 	*/
-	virtual void Interact() override;
+	virtual void GetInteractView(FVector& OutLocation, FVector& OutDirection) const override;
 
 	// Networking Test Example
 	void TestFire();
@@ -196,9 +216,6 @@ public:
 	// Public Functions
 	//======================================================================
 
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 
@@ -6,6 +6,8 @@
 #include "GameFramework/Actor.h"
 #include "PCProjectileBase.generated.h"
 
+class APCProjectilePool;
+
 UCLASS()
 class PROJECTCHARLIE_API APCProjectileBase : public AActor
 {
@@ -17,17 +19,68 @@ public:
 
 	FVector Origin;
 
+	// Simulate this round in the batched ballistics manager instead of moving the actor itself.
+	// The actor then only acts as a visual representation driven by the simulation.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ballistics")
+	bool bUseBallistics;
+
+	// Spawn (from the projectile pool) a visual actor for simulated rounds
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ballistics", meta = (EditCondition = "bUseBallistics"))
+	bool bSpawnRepresentation;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ballistics", meta = (EditCondition = "bUseBallistics")) // Muzzle velocity in cm/s
+	float MuzzleVelocity;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ballistics", meta = (EditCondition = "bUseBallistics")) // Quadratic drag, deceleration = DragCoefficient * Speed^2
+	float DragCoefficient;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ballistics", meta = (EditCondition = "bUseBallistics"))
+	float GravityScale;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ballistics", meta = (EditCondition = "bUseBallistics")) // Seconds before an unimpacted round is discarded
+	float MaxLifetime;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ballistics", meta = (EditCondition = "bUseBallistics"))
+	float BaseDamage;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void LifeSpanExpired() override;
 
+	// The pool that owns this projectile, null if it was spawned directly
+	TWeakObjectPtr<APCProjectilePool> OwningPool;
+
+	bool bIsInPool;
+
+	// Blueprint hook, called after the projectile has been taken out of the pool and placed
+	UFUNCTION(BlueprintImplementableEvent, Category = "Projectile", meta = (DisplayName = "On Acquired From Pool"))
+	void ReceiveAcquiredFromPool();
+
+	// Blueprint hook, called after the projectile has been parked back in the pool
+	UFUNCTION(BlueprintImplementableEvent, Category = "Projectile", meta = (DisplayName = "On Released To Pool"))
+	void ReceiveReleasedToPool();
+
+public:	
 	void SetOrigin(FVector Location);
 
 	UFUNCTION(BlueprintCallable)
 	FVector GetOrigin();
 
+	void SetPool(APCProjectilePool* InPool);
+
+	bool IsInPool() const;
+
+	// Called by the pool when this projectile is handed out. Re-enables and re-launches the projectile.
+	virtual void OnAcquiredFromPool(const FVector& Location, const FRotator& Rotation);
+
+	// Called by the pool when this projectile is parked. Hides and deactivates the projectile.
+	virtual void OnReleasedToPool();
+
+	// Use instead of DestroyActor. Parks pooled projectiles, destroys the rest.
+	UFUNCTION(BlueprintCallable, Category = "Projectile")
+	void ReturnToPool();
 };
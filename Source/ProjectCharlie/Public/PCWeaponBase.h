@@ -5,12 +5,21 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "PCMagazineBase.h"
+#include "Systems/PCSignificanceManager.h"
 #include "PCWeaponBase.generated.h"
 
 class USkeletalMeshComponent; //forward declare
+class UStaticMeshComponent;
 class UDamageType;
 class UParticleSystem;
 class USoundCue;
+class APCWeaponBase;
+class UPCWeaponDefinition;
+struct FPCShotRecord;
+struct FPCWeaponStats;
+
+// Weapon, old owner, new owner
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnPCWeaponOwnerChanged, APCWeaponBase*, AActor*, AActor*);
 
 UENUM(BlueprintType)
 enum class EFiremode : uint8
@@ -46,14 +55,20 @@ protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	USkeletalMeshComponent* MeshComp;
 
 	// General weapon vars
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon") // Shared weapon stats, the stats below are only used by weapons without one
+	UPCWeaponDefinition* Definition;
+
+	// Stats of weapons without a definition are baked once per class from the class defaults, so they can't be changed per weapon
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	EWeaponType WeaponType;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	TArray<EFiremode> FireModes;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Weapon")
@@ -62,8 +77,16 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
 	TSubclassOf<APCMagazineBase> MagazineClass;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon")
-	APCMagazineBase* CurrentMagazine;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Weapon") // The loaded magazine
+	FPCMagazineState Magazine;
+
+	UPROPERTY(Transient) // Shows the loaded magazine, created on first sight and only registered while the weapon is visible
+	UStaticMeshComponent* MagazineMeshComp;
+
+	UPROPERTY(Transient) // What the magazine mesh is attached to, the weapon unless it is in a hand
+	USceneComponent* MagazineParent;
+
+	FName MagazineParentSocket;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon")
 	FName MagazineSocketName;
@@ -71,47 +94,54 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon") // Rate of Fire in Rounds Per Minute
 	float RateOfFire;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon") // Arbitrary number, 8.0f is ideal for a Glock17
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon") // Arbitrary number, 8.0f is ideal for a Glock17
 	float AimSpeed;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon")
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	float HipInertiaModifier;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon")
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	float AimInertiaModifier;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon")
 	TSubclassOf<UDamageType> DamageType;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon") // Resolve shots with an instant trace instead of firing projectiles
+	bool bUseHitscan;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon", meta = (EditCondition = "bUseHitscan")) // Hitscan trace length in cm
+	float HitscanRange;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon", meta = (EditCondition = "bUseHitscan"))
+	float HitscanDamage;
+
 	
-	// Animations
+	// Animations, sounds and effects are soft references streamed in by APCWeaponAssetStreamer while a weapon of this class exists
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Animations")
-	UAnimSequence* EquipAnimation;
+	TSoftObjectPtr<UAnimSequence> EquipAnimation;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Animations")
-	UAnimSequence* ReloadAnimation;
+	TSoftObjectPtr<UAnimSequence> ReloadAnimation;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Animations") // Set the Player's Recoil Animation
-	UAnimSequence* FireAnimation;
+	TSoftObjectPtr<UAnimSequence> FireAnimation;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Animations")
-	UAnimSequence* SingleFireAnimation;
+	TSoftObjectPtr<UAnimSequence> SingleFireAnimation;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Animations")
-	UAnimSequence* AutoFireAnimation;
+	TSoftObjectPtr<UAnimSequence> AutoFireAnimation;
 
 
 	// Firing/Muzzle effects
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Effects")
-	UParticleSystem* MuzzleEffect;
+	TSoftObjectPtr<UParticleSystem> MuzzleEffect;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Effects")
-	USoundCue* FireSound;
-
-	UAudioComponent* FireAudioComponent;
+	TSoftObjectPtr<USoundCue> FireSound;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Effects")
-	UParticleSystem* ImpactEffect;
+	TSoftObjectPtr<UParticleSystem> ImpactEffect;
 	
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Effects")
 	FName MuzzleSocketName;
@@ -123,35 +153,28 @@ protected:
 	TSubclassOf<UCameraShake> FireCamShake;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Effects")
-	USoundCue* EmptyMagSound;
+	TSoftObjectPtr<USoundCue> EmptyMagSound;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Effects")
-	USoundCue* MagEjectSound;
+	TSoftObjectPtr<USoundCue> MagEjectSound;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Effects")
-	USoundCue* MagInsertSound;
+	TSoftObjectPtr<USoundCue> MagInsertSound;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Effects")
-	USoundCue* WeaponRaiseSound;
+	TSoftObjectPtr<USoundCue> WeaponRaiseSound;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Effects")
-	USoundCue* WeaponLowerSound;
+	TSoftObjectPtr<USoundCue> WeaponLowerSound;
 
-	UAudioComponent* MagazineAudioComponent;
-	UAudioComponent* MagazineEjectAudioComponent;
-	UAudioComponent* MagazineInsertAudioComponent;
-	UAudioComponent* WeaponRaiseAudioComponent;
-	UAudioComponent* WeaponLowerAudioComponent;
 
 
 	// Shell eject effects
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Effects")
-	UParticleSystem* ShellEjectEffect;
+	TSoftObjectPtr<UParticleSystem> ShellEjectEffect;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon Effects")
-	USoundCue* ShellEjectSound;
-
-	UAudioComponent* ShellEjectAudioComponent;
+	TSoftObjectPtr<USoundCue> ShellEjectSound;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Weapon Effects")
 	FName ShellEjectSocketName;
@@ -178,18 +201,57 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon Offsets")
 	FVector ADSOffsetVector;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Weapon") // Cosmetic detail level, set by APCSignificanceManager
+	ESignificanceTier SignificanceTier;
+
 	UAnimInstance* PlayerAnimInstance; //Player Mesh's Animation Controller - Saved as a Class Variable
 	UAnimInstance* AnimInstance;
 	int ShotCounter; // Counts how many shots, used for firemodes
 	float LastFireTime; //Private for fire rate
-	float TimeBetweenShots; //Private for fire rate
-	FTimerHandle TimerHandle_TimeBetweenShots;
+	uint16 WeaponId; // Row of our stats in FPCWeaponStatsTable
+
+	// Fire schedule, see UpdateFireSchedule()
+	static const int32 MaxShotsPerFrame = 16;
+	bool bTriggerHeld;
+	float NextShotTime; // World time the next shot is due
+	float PreviousScheduleTime; // World time of the last schedule update
+	FTransform PreviousMuzzleTransform; // Muzzle transform at the last schedule update
+
+	// Shot prediction, see ServerFireShot() and ReconcileShots()
+	static const int32 AcceptedShotHistory = 64;
+	uint16 NextShotSequence; // Owning client, sequence given to the next predicted shot
+	uint16 LastAckedShotSequence; // Owning client, newest shot the server has answered for
+	uint16 FirstShotSinceReload; // Owning client, acks for older shots no longer say anything about the ammo
+	uint16 LastAcceptedShotSequence; // Server
+	float LastAcceptedShotTime; // Server, shooter's timestamp of the last accepted shot, clamped to the server clock
+	float FireTokens; // Server, shots the client may still fire right now, refilled by server time at the fire rate
+	float LastFireTokenTime; // Server, world time FireTokens was last refilled
+	int32 AcceptedShots[AcceptedShotHistory]; // Server, recent accepted shots that may still report a hit, INDEX_NONE once used
+	int32 AcceptedShotsHead;
+	bool bReplayingClientShot; // Server, FireShot is firing a shot the client already predicted
+
+	void RegisterStats();
+	const FPCWeaponStats& GetStats() const;
 
 	virtual void Fire(); // Replaced by "StartFire()". Fire() is not protected
+	virtual void FireShot(const FTransform& MuzzleTransform, float ShotTime);
+	bool CanFireShot() const;
+	FTransform GetMuzzleTransform() const;
+	void UpdateFireSchedule(float Now, const FTransform& CurrentMuzzleTransform);
 	void PlayFireEffects();
+	void UpdateMagazineMesh();
+	void PlayWeaponSound(const TSoftObjectPtr<USoundCue>& Sound, FName SocketName, float Priority);
 
 public:
+	// Broadcast whenever any weapon changes owner (used by the replication graph to keep weapons dependent on their owner)
+	static FOnPCWeaponOwnerChanged OnWeaponOwnerChanged;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual void SetOwner(AActor* NewOwner) override;
+
 	USkeletalMeshComponent* GetGunMeshComp();
+	const USkeletalMeshComponent* GetGunMeshComp() const;
 
 	FVector GetHipLocation();
 	FVector GetAimLocation();
@@ -205,6 +267,12 @@ public:
 	UAnimSequence* GetEquipAnimation();
 	UAnimSequence* GetReloadAnimation();
 
+	// Soft references of everything APCWeaponAssetStreamer loads for this weapon class. Only animations drive gameplay, the rest is skipped without cosmetics
+	void GetStreamedAssets(TArray<FSoftObjectPath>& OutAssets, bool bCosmetics) const;
+
+	// Particle systems to warm up in the effects pool once they are loaded
+	void GetStreamedEffects(TArray<UParticleSystem*>& OutEffects) const;
+
 	void SetHipTransform();
 	void SetAimTransform();
 	void SetZeroTransform();
@@ -214,8 +282,30 @@ public:
 	void StartFire();
 	void StopFire();
 
+	void PlayRemoteFireEffects(int32 ShotCount);
+
+	// Server, fire a shot the owning client already fired locally. False if it is refused.
+	bool ServerFireShot(const FPCShotRecord& Shot);
+
+	// Owning client, correct the ammo count and cancel refused shots once the server acked a batch
+	void ReconcileShots(uint16 AckedSequence, const TArray<uint16>& RejectedSequences, int32 ServerRoundsRemaining);
+
+	// Server, true the first time it is called for an accepted shot
+	bool ConsumeAcceptedShot(uint16 Sequence);
+
+	// Damage of one round from the current magazine, used by the server for client reported hits
+	float GetShotDamage() const;
+
+	TSubclassOf<UDamageType> GetDamageType() const;
+
+	// Refill the loaded magazine
 	void Reload();
 
+	// Swap in a magazine taken from the owner's inventory
+	void LoadMagazine(const FPCMagazineState& NewMagazine);
+
+	TSubclassOf<APCMagazineBase> GetMagazineClass() const;
+
 	void ChangeFiremode();
 	
 	UFUNCTION(BlueprintCallable)
@@ -223,10 +313,17 @@ public:
 
 	TArray<EFiremode> GetFireModes();
 
-	APCMagazineBase* GetCurrentMagazine();
+	const FPCMagazineState& GetMagazine() const;
+
+	// Move the magazine mesh to a hand socket for a reload, and back into the weapon
+	void AttachMagazineToHand(USceneComponent* HandMesh, FName HandSocketName);
+	void AttachMagazineToWeapon();
 
 	void PlayMagEjectSound();
 	void PlayMagInsertSound();
 	void PlayWeaponRaiseSound();
 	void PlayWeaponLowerSound();
+
+	void SetSignificanceTier(ESignificanceTier InTier);
+	ESignificanceTier GetSignificanceTier() const;
 };
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "PCWeaponBase.h"
+#include "PCWeaponDefinition.generated.h"
+
+class UDamageType;
+
+/*
+	Everything the fire path reads about a weapon type, with derived values
+	already worked out. Kept within one cache line.
+*/
+USTRUCT()
+struct FPCWeaponStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	float TimeBetweenShots;
+
+	UPROPERTY()
+	float AimSpeed;
+
+	UPROPERTY()
+	float HipInertiaModifier;
+
+	UPROPERTY()
+	float AimInertiaModifier;
+
+	UPROPERTY()
+	float HitscanRange;
+
+	UPROPERTY()
+	float HitscanDamage;
+
+	UPROPERTY()
+	EFiremode DefaultFireMode;
+
+	UPROPERTY()
+	EWeaponType WeaponType;
+
+	UPROPERTY()
+	bool bUseHitscan;
+
+	FPCWeaponStats();
+
+	static FPCWeaponStats Make(EWeaponType InWeaponType, const TArray<EFiremode>& InFireModes, float InRateOfFire, float InAimSpeed, float InHipInertiaModifier, float InAimInertiaModifier, bool bInUseHitscan, float InHitscanRange, float InHitscanDamage);
+};
+
+/*
+	Shared, read-only definition of a weapon type. The authoring fields are
+	baked into BakedStats when the asset is saved or cooked, so a cooked
+	game only loads the packed stats and registers them in the runtime
+	table the first time a weapon using the definition spawns.
+*/
+UCLASS(BlueprintType)
+class PROJECTCHARLIE_API UPCWeaponDefinition : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPCWeaponDefinition();
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+	EWeaponType WeaponType;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon") // First one is the default
+	TArray<EFiremode> FireModes;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon") // Rate of Fire in Rounds Per Minute
+	float RateOfFire;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon") // Arbitrary number, 8.0f is ideal for a Glock17
+	float AimSpeed;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+	float HipInertiaModifier;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+	float AimInertiaModifier;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+	TSubclassOf<UDamageType> DamageType;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon") // Resolve shots with an instant trace instead of firing projectiles
+	bool bUseHitscan;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon", meta = (EditCondition = "bUseHitscan")) // Hitscan trace length in cm
+	float HitscanRange;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon", meta = (EditCondition = "bUseHitscan"))
+	float HitscanDamage;
+
+	// Row of this definition in FPCWeaponStatsTable
+	uint16 GetWeaponId();
+
+	virtual void PreSave(const class ITargetPlatform* TargetPlatform) override;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+protected:
+	UPROPERTY()
+	FPCWeaponStats BakedStats; // Filled from the fields above on save
+
+	uint16 WeaponId;
+
+	void BakeStats();
+};
+
+/*
+	Process-wide table of weapon stats, one cache line aligned row per
+	weapon type, indexed by weapon id. Rows never move, row 0 holds
+	defaults and is returned for unknown ids or once the table is full.
+	Rows are keyed by the path of their source, so a recompiled Blueprint
+	class or a reloaded definition takes over the row of the one it
+	replaces instead of using up a new one.
+*/
+class PROJECTCHARLIE_API FPCWeaponStatsTable
+{
+public:
+	static const int32 MaxWeapons = 256;
+
+	// Add or update the row for Source (a definition or a weapon class) and return its id
+	static uint16 Register(const UObject* Source, const FPCWeaponStats& Stats);
+
+	// Id of Source's row, 0 if it has none or the row was registered by an older object at the same path
+	static uint16 Find(const UObject* Source);
+
+	static const FPCWeaponStats& Get(uint16 WeaponId);
+};
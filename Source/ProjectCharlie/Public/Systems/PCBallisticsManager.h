@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCBallisticsManager.generated.h"
+
+class APCProjectileBase;
+class UDamageType;
+class UParticleSystem;
+
+/*
+	Everything needed to put one round in flight.
+*/
+struct FPCBallisticRoundParams
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	float DragCoefficient = 0.0f;
+	float GravityScale = 1.0f;
+	float MaxLifetime = 3.0f;
+	float Damage = 0.0f;
+	TSubclassOf<UDamageType> DamageType;
+	UParticleSystem* ImpactEffect = nullptr;
+	AActor* DamageCauser = nullptr;
+	AController* InstigatorController = nullptr;
+	APCProjectileBase* Representation = nullptr;
+	uint16 ShotSequence = 0;
+	bool bCharacterHitsReported = false; // Character hits are reported by the shooting client instead of damaged here
+};
+
+/*
+	A single instant-hit trace requested by a hitscan weapon.
+*/
+struct FPCHitscanParams
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	float Damage = 0.0f;
+	TSubclassOf<UDamageType> DamageType;
+	UParticleSystem* ImpactEffect = nullptr;
+	TWeakObjectPtr<AActor> DamageCauser; // Held across a frame while the trace is in flight
+	TWeakObjectPtr<AController> InstigatorController;
+	uint16 ShotSequence = 0;
+	bool bCharacterHitsReported = false; // Character hits are reported by the shooting client instead of damaged here
+};
+
+/*
+	Per-world batched ballistics simulation. All rounds in flight are stored as
+	structure-of-arrays and integrated in a single loop per frame. Hit detection
+	for simulated rounds and hitscan weapons goes through one batch of async
+	line traces per frame whose results are consumed on the following frame, so
+	physics queries never run on the critical path of APCWeaponBase::Fire.
+	Projectile actors are optional and only act as visuals moved by the simulation.
+*/
+UCLASS()
+class PROJECTCHARLIE_API APCBallisticsManager : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCBallisticsManager();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// Put a round in flight. Returns the index the round was stored at this frame.
+	int32 AddRound(const FPCBallisticRoundParams& Params);
+
+	int32 GetNumRounds() const;
+
+	// Queue an instant-hit trace. It is issued with this frame's batch and resolved next frame.
+	void QueueHitscan(const FPCHitscanParams& Params);
+
+	// Take back a shot the server refused, its round stops and it can no longer hit anything
+	void CancelShot(const AActor* DamageCauser, uint16 ShotSequence);
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Hot data, touched every frame by the integrator
+	TArray<FVector> Positions;
+	TArray<FVector> PreviousPositions;
+	TArray<FVector> Velocities;
+	TArray<float> DragCoefficients;
+	TArray<float> GravityZ;
+	TArray<float> TimesAlive;
+	TArray<float> MaxLifetimes;
+
+	// Cold data, only touched on hit or removal
+	struct FRoundInfo
+	{
+		FVector Origin; // Launch location, reported as the shot start for lag compensation
+		float Damage;
+		TSubclassOf<UDamageType> DamageType;
+		UParticleSystem* ImpactEffect;
+		TWeakObjectPtr<AActor> DamageCauser;
+		TWeakObjectPtr<AController> InstigatorController;
+		TWeakObjectPtr<APCProjectileBase> Representation;
+		uint16 ShotSequence;
+		bool bCharacterHitsReported;
+	};
+	TArray<FRoundInfo> Infos;
+
+	// Rounds to remove at the end of the frame
+	TBitArray<> PendingRemoval;
+
+	// Segment traces issued last frame, UserData is the round index at the time of issue
+	TArray<FTraceHandle> RoundTraces;
+
+	// Hitscan requests gathered this frame, waiting to be issued
+	TArray<FPCHitscanParams> QueuedHitscans;
+
+	// Hitscan traces issued last frame, UserData indexes InFlightHitscans
+	TArray<FTraceHandle> HitscanTraces;
+	TArray<FPCHitscanParams> InFlightHitscans;
+
+	void ConsumeTraceResults();
+
+	void Integrate(float DeltaTime);
+
+	void FlagExpiredRounds();
+
+	void IssueTraces();
+
+	void ApplyHit(const FHitResult& Hit, const FVector& ShotOrigin, const FVector& ShotDirection, float Damage, TSubclassOf<UDamageType> DamageType, UParticleSystem* ImpactEffect, AActor* DamageCauser, AController* InstigatorController, uint16 ShotSequence, bool bCharacterHitsReported);
+
+	FCollisionQueryParams MakeQueryParams(AActor* DamageCauser, AActor* Representation) const;
+
+	bool HasWork() const;
+
+	void UpdateRepresentations();
+
+	void RemovePendingRounds();
+
+	void RemoveRound(int32 Index);
+};
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Systems/PCWorldManager.h"
+#include "PCDamageTelemetry.generated.h"
+
+class UDamageType;
+
+/*
+	One damage event as it is written to the telemetry log. Objects are
+	kept by name so the record can leave the game thread.
+*/
+struct FPCDamageEvent
+{
+	float Time;
+	float Damage;
+	float HealthAfter;
+	FName DamagedActor;
+	FName Instigator;
+	FName DamageCauser;
+	FName DamageType;
+};
+
+/*
+	Per-world damage telemetry, replacing per-hit log lines. Damage events
+	are gathered in a preallocated array on the game thread, which is
+	swapped once per frame with the one a background task appends to a
+	binary log in the project log folder. Stat counters are updated on the
+	push. PC.DamageTelemetry picks what is recorded: 0 nothing, 1 stat
+	counters, 2 counters and the binary log.
+*/
+UCLASS()
+class PROJECTCHARLIE_API APCDamageTelemetry : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCDamageTelemetry();
+
+	// Record one damage event in DamagedActor's world. Does nothing while telemetry is off.
+	static void RecordDamage(const AActor* DamagedActor, float Damage, float HealthAfter, const UDamageType* DamageType, const AController* InstigatedBy, const AActor* DamageCauser);
+
+	virtual void Tick(float DeltaTime) override;
+
+	// Log file of this world, empty until the first event is written
+	FString GetLogFilename() const;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Events of this frame, game thread only
+	TArray<FPCDamageEvent> PendingEvents;
+
+	// Events being written, owned by the flush task while it runs. Swapped with PendingEvents so neither reallocates.
+	TArray<FPCDamageEvent> FlushEvents;
+
+	// Owned by the flush tasks, which run one after another
+	TUniquePtr<FArchive> LogWriter;
+
+	FString LogFilename;
+
+	FGraphEventRef LastFlushTask;
+
+	void Push(const FPCDamageEvent& Event);
+
+	void DispatchFlush();
+
+	void WaitForFlush();
+
+	// Background thread, writes FlushEvents to LogWriter
+	void FlushPendingEvents();
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCEffectsPool.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+class USceneComponent;
+
+/*
+	Free and playing particle components for one template.
+*/
+USTRUCT()
+struct FPCEffectsPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Free;
+
+	// Playing components, oldest first
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Active;
+};
+
+/*
+	Per-world pool of particle system components for weapon effects (muzzle
+	flash, shell eject, impacts). Components are kept warm per template,
+	reattached and reactivated on use and returned automatically when their
+	system finishes. Concurrent instances are capped per template, reusing
+	the oldest one, and effects beyond CullDistance from the local view are
+	not played at all.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCEffectsPool : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCEffectsPool();
+
+	// Components created per template the first time it is used
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Effects Pool")
+	int32 WarmUpSize;
+
+	// Maximum concurrent instances per template, the oldest is recycled past this
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Effects Pool")
+	int32 MaxInstancesPerTemplate;
+
+	// Effects further than this from the local view are skipped, 0 to never cull
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Effects Pool")
+	float CullDistance;
+
+	UParticleSystemComponent* SpawnEffectAttached(UParticleSystem* Template, USceneComponent* AttachToComponent, FName SocketName);
+
+	UParticleSystemComponent* SpawnEffectAtLocation(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation);
+
+	void WarmUp(UParticleSystem* Template);
+
+	// Drop the pool's components and reference for Template so it can be unloaded. Playing instances are destroyed once they finish
+	void ReleaseTemplate(UParticleSystem* Template);
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY()
+	TMap<UParticleSystem*, FPCEffectsPoolBucket> Buckets;
+
+	bool ShouldCull(const FVector& Location) const;
+
+	UParticleSystemComponent* AcquireComponent(UParticleSystem* Template);
+
+	UParticleSystemComponent* CreateComponent(UParticleSystem* Template);
+
+	UFUNCTION()
+	void HandleSystemFinished(UParticleSystemComponent* PSC);
+};
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCInteractableRegistry.generated.h"
+
+/*
+	Loose spatial hash of every actor implementing IInteractable, so
+	characters can find what they are looking at without tracing. Actors
+	are picked up when the registry starts and as they spawn, and are
+	filed under the cell holding their bounds center. An actor is only
+	moved between cells when its root component moves, and a query looks
+	at the cells around it grown by one cell. Actors with bounds larger
+	than a cell are kept in a separate list that every query tests.
+	Settings are read from the [/Script/ProjectCharlie.PCInteractableRegistry]
+	section of DefaultGame.ini.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCInteractableRegistry : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCInteractableRegistry();
+
+	// Edge length of a hash cell, roughly the usual interact distance
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Interaction")
+	float CellSize;
+
+	void RegisterInteractable(AActor* Actor);
+
+	void UnregisterInteractable(AActor* Actor);
+
+	/*
+		Interactable closest to Direction within a cone from Origin,
+		nullptr if there is none. An actor counts as inside the cone if its
+		bounds reach into it, so big objects are easy to look at.
+	*/
+	AActor* FindInteractableInCone(const FVector& Origin, const FVector& Direction, float Range, float HalfAngleDegrees, const AActor* IgnoreActor = nullptr);
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	struct FEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		const AActor* Key; // EntryIndices key, still valid to remove once Actor is gone
+		FVector Center;
+		float Radius;
+		FIntVector Cell; // Unused while bOversize
+		bool bOversize; // Bounds radius above CellSize, kept in OversizeEntries instead of a cell
+		FDelegateHandle MovedHandle; // Bound to the root component's TransformUpdated if it can move
+	};
+
+	TSparseArray<FEntry> Entries;
+
+	TMap<const AActor*, int32> EntryIndices;
+
+	TMap<FIntVector, TArray<int32>> Cells;
+
+	TArray<int32> OversizeEntries;
+
+	FDelegateHandle ActorSpawnedHandle;
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	void UpdateEntry(int32 Index);
+
+	// File the entry under its cell or in OversizeEntries, from its current bounds
+	void LinkEntry(int32 Index);
+
+	void UnlinkEntry(int32 Index);
+
+	void RemoveEntry(int32 Index);
+
+	void OnActorSpawned(AActor* Actor);
+
+	void OnLevelAdded(ULevel* Level, UWorld* World);
+
+	void OnInteractableMoved(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+};
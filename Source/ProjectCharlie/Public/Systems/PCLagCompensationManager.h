@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCLagCompensationManager.generated.h"
+
+class APCCharacter;
+class UDamageType;
+
+/*
+	One sphere hitbox following a bone of the character mesh.
+*/
+USTRUCT()
+struct FPCHitboxDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+	FName BoneName;
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+	float Radius;
+
+	FPCHitboxDefinition()
+		: Radius(0.0f)
+	{
+	}
+};
+
+/*
+	A hit a client claims to have landed on a character, to be checked
+	against where that character was when the client fired.
+*/
+struct FPCHitValidationRequest
+{
+	TWeakObjectPtr<APCCharacter> HitCharacter;
+	FVector ShotStart = FVector::ZeroVector;
+	FVector ShotEnd = FVector::ZeroVector; // Reported impact point, the shot is extended a little past it
+	float RewindTime = 0.0f; // Server world time to rewind HitCharacter to
+	float Damage = 0.0f;
+	TSubclassOf<UDamageType> DamageType;
+	TWeakObjectPtr<AActor> DamageCauser;
+	TWeakObjectPtr<AController> InstigatorController;
+};
+
+/*
+	Server-only history of character hitboxes used to validate client
+	reported hits. Every registered character gets a fixed ring buffer of
+	hitbox snapshots, recorded once per frame, covering MaxRewindTime.
+	Nothing is allocated after registration and characters are never
+	actually moved back in time, a hit is tested analytically against the
+	interpolated snapshot. All hits queued during a frame are validated
+	together in the next tick, grouped by target, and the accepted ones
+	are checked for blocking world geometry with one batch of async traces
+	before their damage is applied.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCLagCompensationManager : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCLagCompensationManager();
+
+	static const int32 MaxHitboxes = 8;
+
+	static const int32 HistoryCapacity = 32; // Enough for MaxRewindTime at up to 128 Hz
+
+	// Hitboxes recorded for every character, at most MaxHitboxes are used
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	TArray<FPCHitboxDefinition> Hitboxes;
+
+	// How far back a hit can be rewound, older shots are checked against the oldest snapshot
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	float MaxRewindTime;
+
+	// How far behind the server clock clients render other characters because of movement smoothing
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	float ProxyInterpolationDelay;
+
+	// Extra slack around every hitbox to absorb interpolation and quantization error
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	float HitboxTolerance;
+
+	// Reported shots starting further than this from the shooter are rejected
+	UPROPERTY(Config, EditAnywhere, Category = "Lag Compensation")
+	float MaxShotOriginError;
+
+	virtual void Tick(float DeltaTime) override;
+
+	void RegisterCharacter(APCCharacter* Character);
+
+	void UnregisterCharacter(APCCharacter* Character);
+
+	// Queue a reported hit, it is validated with the rest of this frame's hits
+	void QueueHitValidation(const FPCHitValidationRequest& Request);
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	struct FSnapshot
+	{
+		float Time;
+		FVector Location; // Actor location, center of the broad phase sphere
+		float BoundsRadius; // Covers every hitbox around Location
+		FVector HitboxCenters[MaxHitboxes];
+	};
+
+	struct FHistory
+	{
+		TWeakObjectPtr<APCCharacter> Character;
+		int32 BoneIndices[MaxHitboxes]; // Resolved once on registration, INDEX_NONE if the mesh lacks the bone
+		int32 BodyIndices[MaxHitboxes]; // Physics body of each hitbox bone, reported as FHitResult::Item
+		int32 Head; // Slot of the newest snapshot
+		int32 Num;
+		FSnapshot Snapshots[HistoryCapacity];
+	};
+
+	// Hit that passed the rewind test and waits for its occlusion trace
+	struct FConfirmedHit
+	{
+		FPCHitValidationRequest Request;
+		FVector ImpactPoint;
+		int32 HitboxIndex;
+		int32 BodyIndex;
+	};
+
+	TArray<FHistory> Histories;
+
+	TMap<const APCCharacter*, int32> HistoryIndices;
+
+	TArray<FPCHitValidationRequest> PendingRequests;
+
+	// Hits confirmed last frame, UserData of each trace indexes ConfirmedHits
+	TArray<FConfirmedHit> ConfirmedHits;
+	TArray<FTraceHandle> OcclusionTraces;
+
+	void RecordSnapshots();
+
+	void ValidatePendingHits();
+
+	void ApplyConfirmedHits();
+
+	// Builds the hitbox centers of History at Time, false if there is nothing recorded
+	bool GetRewoundSnapshot(const FHistory& History, float Time, FSnapshot& OutSnapshot) const;
+
+	// Closest hitbox along the segment, INDEX_NONE if the shot misses every hitbox
+	int32 TraceHitboxes(const FSnapshot& Snapshot, const FVector& Start, const FVector& End, FVector& OutImpactPoint) const;
+};
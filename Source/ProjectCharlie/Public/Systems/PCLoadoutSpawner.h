@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "Engine/StreamableManager.h"
+#include "PCLoadoutSpawner.generated.h"
+
+class APCCharacter;
+class APCWeaponBase;
+
+UENUM(BlueprintType)
+enum class EPCLoadoutSlot : uint8
+{
+	PRIMARY UMETA(DisplayName = "Primary"),
+	SECONDARY UMETA(DisplayName = "Secondary")
+};
+
+/*
+	Spawns character loadouts across frames. Weapon classes are loaded
+	asynchronously when a character asks for them, and loaded weapons are
+	spawned in request order until the frame's time budget is spent, so a
+	wave of characters spawned in one frame doesn't spawn all of their
+	weapons in that frame too.
+	Budget settings are read from the [/Script/ProjectCharlie.PCLoadoutSpawner]
+	section of DefaultGame.ini.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCLoadoutSpawner : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCLoadoutSpawner();
+
+	// Milliseconds per frame spent spawning weapons
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Loadout")
+	float FrameBudgetMs;
+
+	// Weapons spawned every frame even if the first one blew the budget
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Loadout")
+	int32 MinSpawnsPerFrame;
+
+	// Queue a weapon for Character. The character's OnLoadoutWeaponSpawned is called once it exists
+	void RequestWeapon(APCCharacter* Character, TSoftClassPtr<APCWeaponBase> WeaponClass, EPCLoadoutSlot Slot);
+
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	struct FRequest
+	{
+		TWeakObjectPtr<APCCharacter> Character;
+		TSoftClassPtr<APCWeaponBase> WeaponClass;
+		TSharedPtr<FStreamableHandle> LoadHandle; // Set while the class is loading, keeps it referenced until the weapon is spawned
+		EPCLoadoutSlot Slot;
+		bool bPrefetched; // The weapon's animations, sounds and effects were handed to the asset streamer
+	};
+
+	TArray<FRequest> Requests;
+
+	void PrefetchWeaponAssets(FRequest& Request, UClass* WeaponClass);
+};
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCProjectilePool.generated.h"
+
+class APCProjectileBase;
+
+/*
+	Usage counters for a single projectile class, used to size pools per map.
+*/
+USTRUCT(BlueprintType)
+struct FPCProjectilePoolStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool") // Acquires served from the free list
+	int32 Hits = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool") // Acquires that had to spawn a new projectile
+	int32 Misses = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool") // Acquires refused because the pool was at its cap
+	int32 Refused = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool") // Pooled projectiles destroyed by something other than the pool, free or in use
+	int32 Lost = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool") // Highest number of projectiles in flight at once
+	int32 PeakInUse = 0;
+};
+
+/*
+	Free list and bookkeeping for one projectile class.
+*/
+USTRUCT()
+struct FPCProjectilePoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<APCProjectileBase*> Free;
+
+	int32 InUse = 0;
+	int32 PeakInUseSinceShrink = 0;
+
+	FPCProjectilePoolStats Stats;
+};
+
+/*
+	Per-world pool that pre-allocates and recycles APCProjectileBase actors per
+	projectile class, replacing a SpawnActor/Destroy pair for every round fired.
+	Sizes are read from the [/Script/ProjectCharlie.PCProjectilePool] section of
+	DefaultGame.ini and can be overridden at runtime (e.g. from a level blueprint).
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCProjectilePool : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCProjectilePool();
+
+	// Number of projectiles spawned up front the first time a class is warmed up
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Projectile Pool")
+	int32 DefaultWarmUpSize;
+
+	// Per-class warm-up sizes, overriding DefaultWarmUpSize
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Projectile Pool")
+	TMap<TSubclassOf<APCProjectileBase>, int32> WarmUpSizes;
+
+	// Grow policy: spawn a new projectile when the free list is empty. If false, acquires fail instead.
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Projectile Pool")
+	bool bGrowOnDemand;
+
+	// Hard cap on projectiles (free + in use) per class, 0 for no cap
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Projectile Pool")
+	int32 MaxPoolSize;
+
+	// Shrink policy: how often (seconds) idle projectiles above the recent peak are destroyed, 0 to never shrink
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Projectile Pool")
+	float ShrinkInterval;
+
+	// Pre-spawn projectiles of the given class up to its configured warm-up size
+	UFUNCTION(BlueprintCallable, Category = "Projectile Pool")
+	void WarmUp(TSubclassOf<APCProjectileBase> ProjectileClass);
+
+	// Pre-spawn projectiles of the given class up to Count free instances
+	UFUNCTION(BlueprintCallable, Category = "Projectile Pool")
+	void WarmUpCount(TSubclassOf<APCProjectileBase> ProjectileClass, int32 Count);
+
+	// Take a projectile out of the pool and place it. Returns nullptr if the pool refused.
+	APCProjectileBase* AcquireProjectile(TSubclassOf<APCProjectileBase> ProjectileClass, const FVector& Location, const FRotator& Rotation, AActor* InOwner, APawn* InInstigator);
+
+	// Return a projectile to the pool. Called by APCProjectileBase::ReturnToPool.
+	void ReleaseProjectile(APCProjectileBase* Projectile);
+
+	// An acquired projectile was destroyed instead of returned. Called by APCProjectileBase::EndPlay.
+	void NotifyProjectileLost(APCProjectileBase* Projectile);
+
+	UFUNCTION(BlueprintCallable, Category = "Projectile Pool")
+	FPCProjectilePoolStats GetPoolStats(TSubclassOf<APCProjectileBase> ProjectileClass) const;
+
+	// Write the stats of every bucket to the log
+	void LogPoolStats() const;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY()
+	TMap<UClass*, FPCProjectilePoolBucket> Buckets;
+
+	FTimerHandle TimerHandle_Shrink;
+
+	APCProjectileBase* SpawnPooledProjectile(UClass* ProjectileClass);
+
+	int32 GetWarmUpSize(UClass* ProjectileClass) const;
+
+	void Shrink();
+};
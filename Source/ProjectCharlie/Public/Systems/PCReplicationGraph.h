@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "PCReplicationGraph.generated.h"
+
+class APCCharacter;
+class APCWeaponBase;
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+
+/*
+	How a replicated class is routed into the graph.
+*/
+enum class EClassRepNodeMapping : uint32
+{
+	NOT_ROUTED, // Not routed to a node. Player controllers, or dependents of another actor (weapons, magazines)
+	RELEVANT_ALL_CONNECTIONS, // Always relevant to everyone (game state, player states)
+	RELEVANT_OWNER_CONNECTION, // Only relevant to the connection owning it (bOnlyRelevantToOwner)
+	SPATIALIZE_STATIC, // Spatialized once, never moves
+	SPATIALIZE_DYNAMIC, // Spatialized and re-bucketed every frame (pawns, anything with replicated movement)
+	SPATIALIZE_DORMANCY // Static while dormant, dynamic while awake
+};
+
+/*
+	Project replication graph. Pawns and other world actors live in a 2D grid
+	so each connection only gathers the cells around its viewer. Game state
+	and player states go to a global always-relevant list. Each connection
+	gets a node for its own controller and view target, and a list of the
+	owner-only actors it owns, see UpdateOwnerRelevantActors(). Weapons and
+	their magazines are not routed: they replicate as dependents of their
+	owner, so they are considered only when the owning character is.
+	Characters also replicate less often to connections that are far away
+	from them or looking elsewhere, see UpdateViewPriorities().
+*/
+UCLASS(Transient, Config = Engine)
+class PROJECTCHARLIE_API UPCReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UPCReplicationGraph();
+
+	// Size of one spatialization cell in uu
+	UPROPERTY(Config)
+	float GridCellSize;
+
+	// Grid origin offset, should put the minimum corner of the playable area at (0, 0)
+	UPROPERTY(Config)
+	float SpatialBiasX;
+
+	UPROPERTY(Config)
+	float SpatialBiasY;
+
+	// Don't rebuild the grid when an actor leaves the biased bounds, let it clamp to the edge cell instead
+	UPROPERTY(Config)
+	bool bDisableSpatialRebuilding;
+
+	// Frames between updates of the per connection character replication periods
+	UPROPERTY(Config)
+	int32 ViewPriorityUpdateFrames;
+
+	// A character a connection barely cares about replicates at most this many times less often to it
+	UPROPERTY(Config)
+	int32 MaxViewPeriodMultiplier;
+
+	// Connections at or below this net speed (bytes/s) count as low bandwidth
+	UPROPERTY(Config)
+	int32 LowBandwidthNetSpeed;
+
+	virtual void InitGlobalActorClassSettings() override;
+
+	virtual void InitGlobalGraphNodes() override;
+
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+
+	// Make Child replicate whenever Parent does
+	void AddDependentActor(AActor* Parent, AActor* Child);
+
+	void RemoveDependentActor(AActor* Parent, AActor* Child);
+
+	// Logs average/peak server replication time per frame since the last call, then resets
+	void LogReplicationStats();
+
+	// The graph reads NetUpdateFrequency once per class, call this after changing it on a single actor
+	static void NotifyNetUpdateFrequencyChanged(AActor* Actor);
+
+protected:
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	// Per connection list of the owner-only actors it owns
+	UPROPERTY()
+	TMap<UNetReplicationGraphConnection*, UReplicationGraphNode_ActorList*> OwnerRelevantNodes;
+
+	// Owner-only actors whose owner had no connection yet when they were added, retried every frame
+	TArray<FNewReplicatedActorInfo> PendingOwnerRelevantActors;
+
+	// Connection whose list each routed owner-only actor is in
+	TMap<AActor*, UNetReplicationGraphConnection*> OwnerRelevantConnections;
+
+	void UpdateOwnerRelevantActors();
+
+	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+
+	// ServerReplicateActors timing for PC.RepGraph.Stats
+	double TotalReplicateSeconds;
+
+	double PeakReplicateSeconds;
+
+	int32 ReplicateFrames;
+
+	// Characters whose replication period is scaled per connection, see UpdateViewPriorities()
+	TArray<TWeakObjectPtr<APCCharacter>> ViewPrioritizedCharacters;
+
+	int32 FramesSinceViewPriorityUpdate;
+
+	void UpdateViewPriorities(float DeltaSeconds);
+
+	EClassRepNodeMapping GetMappingPolicy(UClass* Class);
+
+	uint32 GetReplicationPeriodFrame(float NetUpdateFrequency) const;
+
+	EClassRepNodeMapping ComputeMappingPolicy(const UClass* Class) const;
+
+	bool IsDependentClass(const UClass* Class) const;
+
+	// Add an owner-only actor to its owning connection's list, false if it has none yet
+	bool RouteOwnerRelevantActor(const FNewReplicatedActorInfo& ActorInfo);
+
+	void UnrouteOwnerRelevantActor(const FNewReplicatedActorInfo& ActorInfo);
+
+	void HandleWeaponOwnerChanged(APCWeaponBase* Weapon, AActor* OldOwner, AActor* NewOwner);
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCSignificanceManager.generated.h"
+
+class APCWeaponBase;
+
+/*
+	How much cosmetic work a weapon is allowed to do, from everything down to nothing.
+*/
+UENUM(BlueprintType)
+enum class ESignificanceTier : uint8
+{
+	FULL UMETA(DisplayName = "Full"), // Muzzle effect, recoil montage, weapon animation, sound, camera shake
+	REDUCED UMETA(DisplayName = "Reduced"), // Muzzle effect and sound, no montages
+	MINIMAL UMETA(DisplayName = "Minimal"), // Sound only
+	SKIP UMETA(DisplayName = "Skip") // No cosmetics
+};
+
+/*
+	Scores every registered weapon at a fixed interval by distance to the local
+	view, whether it was recently rendered and whether a local player owns it,
+	and stores the resulting tier on the weapon. Cosmetic paths read the cached
+	tier instead of doing their own checks on every shot.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCSignificanceManager : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCSignificanceManager();
+
+	// Seconds between significance updates
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Significance")
+	float UpdateInterval;
+
+	// Visible weapons closer than this get FULL
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Significance")
+	float FullDistance;
+
+	// Visible weapons closer than this get REDUCED
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Significance")
+	float ReducedDistance;
+
+	// Any weapon closer than this gets MINIMAL (can still be heard), beyond it SKIP
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Significance")
+	float AudibleDistance;
+
+	virtual void Tick(float DeltaTime) override;
+
+	void RegisterWeapon(APCWeaponBase* Weapon);
+
+	void UnregisterWeapon(APCWeaponBase* Weapon);
+
+protected:
+	virtual void BeginPlay() override;
+
+	TArray<TWeakObjectPtr<APCWeaponBase>> Weapons;
+
+	ESignificanceTier ScoreWeapon(const APCWeaponBase* Weapon, const FVector& ViewLocation) const;
+};
@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCTickManager.generated.h"
+
+/*
+	All objects of one class that the tick manager updates together.
+	The typed part lives in TPCTickBucket so every object in a bucket is
+	updated from one tight loop over a contiguous array.
+*/
+class FPCTickBucket
+{
+public:
+	virtual ~FPCTickBucket() {}
+
+	virtual void TickObjects(float DeltaTime) = 0;
+
+	virtual int32 Num() const = 0;
+
+	FName TypeName;
+
+	float Interval = 0.0f; // Seconds between updates, 0 for every frame
+
+	float TimeSinceTick = 0.0f;
+
+	TStatId StatId;
+
+	// Totals since the last PC.TickManager.ResetStats
+	int32 BatchCount = 0;
+
+	int32 ObjectTickCount = 0;
+
+	double TotalSeconds = 0.0;
+};
+
+/*
+	Bucket for objects of type T. T must implement ManagedTick(float DeltaTime).
+	Objects can unregister themselves (or others) from inside ManagedTick, the
+	slot is cleared and compacted after the loop. Objects registered during the
+	loop are first updated on the next batch.
+*/
+template<class T>
+class TPCTickBucket : public FPCTickBucket
+{
+public:
+	void Add(T* Object)
+	{
+		Objects.AddUnique(Object);
+	}
+
+	void Remove(T* Object)
+	{
+		const int32 Index = Objects.Find(Object);
+		if (Index == INDEX_NONE)
+		{
+			return;
+		}
+
+		if (bTicking)
+		{
+			Objects[Index] = nullptr;
+			bNeedsCompact = true;
+		}
+		else
+		{
+			Objects.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	virtual void TickObjects(float DeltaTime) override
+	{
+		bTicking = true;
+
+		const int32 Count = Objects.Num();
+		for (int32 i = 0; i < Count; i++)
+		{
+			if (T* Object = Objects[i])
+			{
+				Object->ManagedTick(DeltaTime);
+			}
+		}
+
+		bTicking = false;
+
+		if (bNeedsCompact)
+		{
+			Objects.RemoveAllSwap([](const T* Object) { return Object == nullptr; }, false);
+			bNeedsCompact = false;
+		}
+	}
+
+	virtual int32 Num() const override
+	{
+		return Objects.Num();
+	}
+
+private:
+	TArray<T*> Objects;
+
+	bool bTicking = false;
+
+	bool bNeedsCompact = false;
+};
+
+/*
+	Central tick for lightweight per-object updates. Objects register by type,
+	each type is ticked as one batch at its configured interval and the
+	manager stops ticking while every bucket is empty. Every type gets its own
+	cycle stat in "stat PCTickManager", and PC.TickManager.Stats logs per-type
+	update counts and time.
+	Registered objects must unregister before they are destroyed.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCTickManager : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCTickManager();
+
+	// Seconds between batches per type, keyed by class name without prefix (e.g. PCTransitionComponent). Missing types tick every frame
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Tick")
+	TMap<FName, float> TickIntervals;
+
+	template<class T>
+	void RegisterTick(T* Object)
+	{
+		if (!Object)
+		{
+			return;
+		}
+
+		TPCTickBucket<T>* Bucket = static_cast<TPCTickBucket<T>*>(FindBucket(T::StaticClass()));
+		if (!Bucket)
+		{
+			Bucket = new TPCTickBucket<T>();
+			AddBucket(T::StaticClass(), Bucket);
+		}
+
+		Bucket->Add(Object);
+		SetActorTickEnabled(true);
+	}
+
+	template<class T>
+	void UnregisterTick(T* Object)
+	{
+		if (TPCTickBucket<T>* Bucket = static_cast<TPCTickBucket<T>*>(FindBucket(T::StaticClass())))
+		{
+			Bucket->Remove(Object);
+		}
+	}
+
+	virtual void Tick(float DeltaTime) override;
+
+	void LogTickStats() const;
+
+	void ResetTickStats();
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	TMap<UClass*, TUniquePtr<FPCTickBucket>> Buckets;
+
+	FPCTickBucket* FindBucket(UClass* Class) const;
+
+	void AddBucket(UClass* Class, FPCTickBucket* Bucket);
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "Engine/StreamableManager.h"
+#include "PCWeaponAssetStreamer.generated.h"
+
+/*
+	Memory held by the streamed assets of one weapon family, the folder
+	under Content/Weapons a weapon class lives in (Rifles, Pistols, ...).
+*/
+struct FPCWeaponFamilyStats
+{
+	FName Family;
+	int32 NumWeaponClasses = 0;
+	int32 NumAssets = 0;
+	int32 NumLoadedAssets = 0;
+	int64 ResourceSizeBytes = 0;
+};
+
+/*
+	Streams in the animations, sounds and effects of weapon classes. A
+	class's assets are prefetched when it enters a loadout, kept while any
+	weapon of the class exists and released ReleaseDelay seconds after
+	the last one is gone. Servers without cosmetics only load animations.
+	PC.WeaponAssets.Stats logs memory per weapon family.
+	Settings are read from the [/Script/ProjectCharlie.PCWeaponAssetStreamer]
+	section of DefaultGame.ini.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCWeaponAssetStreamer : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCWeaponAssetStreamer();
+
+	// Seconds a weapon class's assets stay loaded after its last weapon is gone
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Weapon Assets")
+	float ReleaseDelay;
+
+	// Start loading WeaponClass's assets ahead of its first weapon, released like unused assets if none shows up
+	void PrefetchAssets(UClass* WeaponClass);
+
+	// Called by every weapon for its class in BeginPlay and EndPlay
+	void AcquireAssets(UClass* WeaponClass);
+	void ReleaseAssets(UClass* WeaponClass);
+
+	void GetFamilyStats(TArray<FPCWeaponFamilyStats>& OutStats) const;
+
+	void LogAssetStats() const;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	struct FEntry
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+		TArray<FSoftObjectPath> Assets;
+		FName Family;
+		int32 RefCount = 0;
+		float UnusedSince = 0.0f;
+	};
+
+	TMap<TWeakObjectPtr<UClass>, FEntry> Entries;
+
+	FTimerHandle TimerHandle_ReleaseUnused;
+
+	FEntry& FindOrLoad(UClass* WeaponClass);
+
+	void OnAssetsLoaded(TWeakObjectPtr<UClass> WeaponClass);
+
+	void ReleaseUnused();
+
+	static FName GetWeaponFamily(const UClass* WeaponClass);
+};
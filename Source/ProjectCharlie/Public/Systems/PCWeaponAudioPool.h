@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Systems/PCWorldManager.h"
+#include "PCWeaponAudioPool.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+class USceneComponent;
+
+/*
+	Per-world pool of audio voices shared by every weapon. Weapons borrow a
+	voice for one-shot playback at a socket instead of each owning a set of
+	audio components. When the voice budget is exhausted the voice with the
+	lowest effective priority (priority attenuated by distance to the
+	listener) is stolen, or the new sound is dropped if it would rank lower.
+*/
+UCLASS(Config = Game)
+class PROJECTCHARLIE_API APCWeaponAudioPool : public APCWorldManager
+{
+	GENERATED_BODY()
+
+public:
+	APCWeaponAudioPool();
+
+	// Maximum number of weapon sounds playing at once
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Weapon Audio")
+	int32 VoiceBudget;
+
+	// Distance (cm) at which a sound's priority is halved for voice stealing
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Weapon Audio")
+	float PriorityHalfDistance;
+
+	// Play a one-shot sound attached to a socket. Returns false if the sound was dropped.
+	bool PlaySoundAttached(USoundBase* Sound, USceneComponent* AttachToComponent, FName SocketName, float Priority);
+
+protected:
+	virtual void BeginPlay() override;
+
+	UPROPERTY()
+	TArray<UAudioComponent*> Voices;
+
+	// Priority of the sound each voice is playing
+	TArray<float> VoicePriorities;
+
+	float GetEffectivePriority(float Priority, const FVector& Location, const FVector& ListenerLocation) const;
+
+	bool GetListenerLocation(FVector& OutLocation) const;
+
+	void HandleVoiceFinished(UAudioComponent* Voice);
+};
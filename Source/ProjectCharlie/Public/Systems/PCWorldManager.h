@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "PCWorldManager.generated.h"
+
+/*
+	Base class for per-world manager actors (pools, batched simulations, etc.).
+	Managers are never placed in a level. The first call to Get<T>() spawns a
+	transient, non-replicated instance in the calling world and every later call
+	returns the cached instance.
+*/
+UCLASS(Abstract, NotBlueprintable, Transient)
+class PROJECTCHARLIE_API APCWorldManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	APCWorldManager();
+
+	// Returns the manager of type T for the world of WorldContextObject, spawning it if needed.
+	// Returns nullptr outside of game worlds or while the world is tearing down.
+	template<class T>
+	static T* Get(const UObject* WorldContextObject)
+	{
+		return Cast<T>(GetOrCreate(WorldContextObject, T::StaticClass()));
+	}
+
+	// Returns the manager of type T only if it has already been created.
+	template<class T>
+	static T* Find(const UObject* WorldContextObject)
+	{
+		return Cast<T>(FindExisting(WorldContextObject, T::StaticClass()));
+	}
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	static APCWorldManager* GetOrCreate(const UObject* WorldContextObject, UClass* ManagerClass);
+	static APCWorldManager* FindExisting(const UObject* WorldContextObject, UClass* ManagerClass);
+};